@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "mem_track.h"
+
+Arena frame_arena;
+Arena scratch_arena;
+
+// heap block handed out when the arena is full, kept on a list so rewinds free it
+struct ArenaSpill {
+    ArenaSpill *next;
+    size_t size;
+    unsigned long long serial;
+};
+#define SPILL_HEADER ((sizeof(ArenaSpill) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+
+int ArenaInit(Arena *arena, const char *name, size_t capacity)
+{
+    memset(arena, 0, sizeof(*arena));
+    arena->name = name;
+    arena->base = MemTrackAlloc(MEM_TRANSIENT, capacity);
+    if (!arena->base) {
+        // still usable, every request just spills to the heap
+        perror("error allocating");
+        return 1;
+    }
+    arena->capacity = capacity;
+    return 0;
+}
+
+// frees every spill numbered from serial on, wherever it sits in the list
+static void free_spills(Arena *arena, unsigned long long serial)
+{
+    ArenaSpill **link = &arena->spill_list;
+    while (*link) {
+        ArenaSpill *spill = *link;
+        if (spill->serial < serial) {
+            link = &spill->next;
+            continue;
+        }
+        *link = spill->next;
+        MemTrackFree(MEM_TRANSIENT, spill);
+    }
+}
+
+void ArenaDestroy(Arena *arena)
+{
+    free_spills(arena, 0);
+    MemTrackFree(MEM_TRANSIENT, arena->base);
+    arena->base = NULL;
+    arena->capacity = arena->offset = arena->last = 0;
+}
+
+static int owns(const Arena *arena, const void *ptr)
+{
+    const unsigned char *p = ptr;
+    return arena->base && p >= arena->base && p < arena->base + arena->capacity;
+}
+
+static ArenaSpill *spill_of(void *ptr)
+{
+    return (ArenaSpill *)((unsigned char *)ptr - SPILL_HEADER);
+}
+
+static ArenaSpill **link_of(Arena *arena, ArenaSpill *spill)
+{
+    ArenaSpill **link = &arena->spill_list;
+    while (*link && *link != spill)
+        link = &(*link)->next;
+    return link;
+}
+
+static void note_offset(Arena *arena)
+{
+    if (arena->offset > arena->peak)
+        arena->peak = arena->offset;
+    if (arena->offset > arena->period_peak)
+        arena->period_peak = arena->offset;
+}
+
+void *ArenaAlloc(Arena *arena, size_t size)
+{
+    arena->allocations++;
+    arena->period_allocations++;
+
+    size_t start = (arena->offset + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    if (arena->base && start <= arena->capacity && size <= arena->capacity - start) {
+        arena->last = start;
+        arena->offset = start + size;
+        note_offset(arena);
+        return arena->base + start;
+    }
+
+    ArenaSpill *spill = MemTrackAlloc(MEM_TRANSIENT, SPILL_HEADER + size);
+    if (!spill)
+        return NULL;
+    spill->size = size;
+    spill->serial = arena->spill_serial++;
+    spill->next = arena->spill_list;
+    arena->spill_list = spill;
+    arena->spills++;
+    arena->spilled_bytes += size;
+    return (unsigned char *)spill + SPILL_HEADER;
+}
+
+void *ArenaRealloc(Arena *arena, void *ptr, size_t old_size, size_t new_size)
+{
+    if (!ptr)
+        return ArenaAlloc(arena, new_size);
+    if (!owns(arena, ptr)) {
+        // grown in place in the list, keeping its serial and so its owner
+        ArenaSpill **link = link_of(arena, spill_of(ptr));
+        ArenaSpill *grown = MemTrackRealloc(MEM_TRANSIENT, *link, SPILL_HEADER + new_size);
+        if (!grown)
+            return NULL;    // the old block stays valid
+        grown->size = new_size;
+        *link = grown;
+        return (unsigned char *)grown + SPILL_HEADER;
+    }
+
+    size_t start = (unsigned char *)ptr - arena->base;
+    if (start == arena->last && new_size <= arena->capacity - start) {
+        // the newest allocation grows or shrinks where it is
+        arena->offset = start + new_size;
+        note_offset(arena);
+        return ptr;
+    }
+    if (new_size <= old_size)
+        return ptr;
+
+    void *moved = ArenaAlloc(arena, new_size);
+    if (moved)
+        memcpy(moved, ptr, old_size);
+    return moved;
+}
+
+void ArenaFree(Arena *arena, void *ptr)
+{
+    if (!ptr)
+        return;
+    if (!owns(arena, ptr)) {
+        ArenaSpill **link = link_of(arena, spill_of(ptr));
+        ArenaSpill *spill = *link;
+        *link = spill->next;
+        MemTrackFree(MEM_TRANSIENT, spill);
+        return;
+    }
+    // only the newest allocation can be handed back early
+    size_t start = (unsigned char *)ptr - arena->base;
+    if (start == arena->last)
+        arena->offset = start;
+}
+
+ArenaMarker ArenaMark(const Arena *arena)
+{
+    return (ArenaMarker) {arena->offset, arena->spill_serial};
+}
+
+// frees everything allocated since the mark, the arena part and any spills
+void ArenaRelease(Arena *arena, ArenaMarker mark)
+{
+    free_spills(arena, mark.spill_serial);
+    if (mark.offset < arena->offset) {
+        arena->offset = mark.offset;
+        arena->last = mark.offset;
+    }
+}
+
+void ArenaReset(Arena *arena)
+{
+    free_spills(arena, 0);
+    arena->offset = arena->last = 0;
+    arena->period_peak = 0;
+    arena->period_allocations = 0;
+    arena->resets++;
+}
+
+void ArenaPrintStats(const Arena *arena)
+{
+    printf("%s arena: %.1f KiB in use, peak %.1f of %.1f KiB, %llu allocations",
+           arena->name, arena->offset / 1024.0, arena->peak / 1024.0, arena->capacity / 1024.0,
+           arena->allocations);
+    if (arena->resets)
+        printf(" (%llu since reset, peak %.1f KiB)", arena->period_allocations, arena->period_peak / 1024.0);
+    printf(", %llu spilled to the heap (%.1f KiB)\n", arena->spills, arena->spilled_bytes / 1024.0);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <stddef.h>
+
+// Linear allocators for CPU-side buffers that only live for a frame or for
+// one loading step. Allocation bumps an offset; memory comes back in bulk by
+// rewinding to a mark or resetting. ArenaFree() only reclaims the most
+// recent allocation, anything else waits for the next rewind. Requests that
+// do not fit spill to the heap, are freed by the same rewinds and are
+// counted, so the sizes can be tuned.
+#define ARENA_ALIGNMENT 16
+
+#define FRAME_ARENA_SIZE (1u << 20)
+#define SCRATCH_ARENA_SIZE (16u << 20) // a decoded 2k texture plus the decoder's planes (~12 MiB)
+
+typedef struct ArenaSpill ArenaSpill;
+
+typedef struct {
+    const char *name;
+    unsigned char *base;
+    size_t capacity;
+    size_t offset;
+    size_t last;               // offset of the newest allocation, it can grow or be freed in place
+    ArenaSpill *spill_list;    // live heap spills
+    unsigned long long spill_serial;   // the next spill's serial number
+
+    size_t peak;               // highest offset ever reached
+    size_t period_peak;        // highest offset since the last reset
+    unsigned long long allocations;
+    unsigned long long period_allocations;
+    unsigned long long spills; // requests served by malloc because the arena was full
+    size_t spilled_bytes;
+    unsigned long long resets;
+} Arena;
+
+// spills are told apart by serial rather than list position, so freeing or
+// growing one from before the mark cannot make a release free past it
+typedef struct {
+    size_t offset;
+    unsigned long long spill_serial;
+} ArenaMarker;
+
+extern Arena frame_arena;      // reset at the top of every frame
+extern Arena scratch_arena;    // startup and asset loading, rewound by whoever marked it
+
+int ArenaInit(Arena *arena, const char *name, size_t capacity);
+void ArenaDestroy(Arena *arena);
+
+void *ArenaAlloc(Arena *arena, size_t size);
+void *ArenaRealloc(Arena *arena, void *ptr, size_t old_size, size_t new_size);
+void ArenaFree(Arena *arena, void *ptr);
+
+ArenaMarker ArenaMark(const Arena *arena);
+void ArenaRelease(Arena *arena, ArenaMarker mark);
+void ArenaReset(Arena *arena);
+
+void ArenaPrintStats(const Arena *arena);
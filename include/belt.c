@@ -0,0 +1,277 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "belt.h"
+#include "gl_state.h"
+#include "frame_stats.h"
+#include "arena.h"
+#include "mem_track.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+
+// splitmix64, small and the same sequence everywhere
+static uint64_t next(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static double uniform(uint64_t *state)
+{
+    return (next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static bool in_gap(const BeltPopulation *population, double a)
+{
+    for (int g = 0; g < population->gap_count; g++) {
+        if (fabs(a - population->gaps[g]) < population->gap_half_width)
+            return true;
+    }
+    return false;
+}
+
+static OrbitalElements random_orbit(const BeltPopulation *population, double gm, uint64_t *state)
+{
+    double a;
+    do {
+        a = population->inner + (population->outer - population->inner) * uniform(state);
+    } while (in_gap(population, a));
+    // eccentricities lean low, inclinations are half-normal about the plane
+    double e = population->eccentricity * sqrt(uniform(state)) * uniform(state);
+    double gauss = sqrt(-2 * log(1 - uniform(state))) * cos(2 * M_PI * uniform(state));
+    return (OrbitalElements) {
+        .semi_major_axis = a, .eccentricity = e, .inclination = fabs(gauss) * population->inclination,
+        .ascending_node = 2 * M_PI * uniform(state), .argument_periapsis = 2 * M_PI * uniform(state),
+        .mean_anomaly = 2 * M_PI * uniform(state), .mean_motion = KeplerMeanMotion(a, gm),
+    };
+}
+
+// the static half of a particle, from axes already scaled by a and b
+static void set_orbit(BeltOrbit *orbit, const KeplerOrbits *orbits, int k, float brightness)
+{
+    orbit->periapsis[0] = orbits->px[k];
+    orbit->periapsis[1] = orbits->py[k];
+    orbit->periapsis[2] = orbits->pz[k];
+    orbit->ahead[0] = orbits->qx[k];
+    orbit->ahead[1] = orbits->qy[k];
+    orbit->ahead[2] = orbits->qz[k];
+    orbit->eccentricity = orbits->eccentricity[k];
+    orbit->mean_motion = orbits->mean_motion[k];
+    orbit->brightness = brightness;
+}
+
+bool BeltHasBody(const Catalogue *catalogue, int body)
+{
+    double e = catalogue->eccentricity[body];
+    return catalogue->parent[body] < 0 && catalogue->texture[body] < 0 && catalogue->semi_major_axis[body] > 0
+        && e >= 0 && e <= KEPLER_MAX_ECCENTRICITY;
+}
+
+static int next_body(const Belt *belt, int body)
+{
+    while (!BeltHasBody(belt->catalogue, body))
+        body++;
+    return body;
+}
+
+// the catalogue body's orbit in world units, as planets_setup would add it
+static OrbitalElements catalogue_orbit(const Belt *belt, int body)
+{
+    const Catalogue *c = belt->catalogue;
+    double scale = belt->units_per_km;
+    double a = c->semi_major_axis[body] * scale;
+    return (OrbitalElements) {
+        .semi_major_axis = a, .eccentricity = c->eccentricity[body], .inclination = c->inclination[body],
+        .ascending_node = c->ascending_node[body], .argument_periapsis = c->argument_periapsis[body],
+        .mean_anomaly = c->mean_anomaly[body],
+        .mean_motion = KeplerMeanMotion(a, belt->gm + c->gm[body] * scale * scale * scale),
+    };
+}
+
+// mean anomalies of particles [from, to) at the epoch, into the given
+// anomaly buffer; the particles are always walked in order, the
+// catalogue's with a cursor
+static void upload_anomalies(Belt *belt, GLuint buffer, int from, int to, double epoch)
+{
+    ArenaMarker mark = ArenaMark(&frame_arena);
+    float *anomalies = ArenaAlloc(&frame_arena, (to - from) * sizeof(float));
+    if (!anomalies) {
+        perror("error allocating belt");
+        return;
+    }
+    for (int k = from; k < to; k++) {
+        double M, n;
+        if (k < belt->generated) {
+            M = belt->mean_anomaly[k];
+            n = belt->mean_motion[k];
+        } else {
+            if (k == belt->generated)
+                belt->cursor = 0;
+            belt->cursor = next_body(belt, belt->cursor);
+            OrbitalElements elements = catalogue_orbit(belt, belt->cursor++);
+            M = elements.mean_anomaly;
+            n = elements.mean_motion;
+        }
+        double angle = M + n * epoch;
+        anomalies[k - from] = angle - 2 * M_PI * floor(angle * (1 / (2 * M_PI)) + 0.5);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferSubData(GL_ARRAY_BUFFER, from * sizeof(float), (to - from) * sizeof(float), anomalies);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    ArenaRelease(&frame_arena, mark);
+}
+
+static void point_at_anomalies(Belt *belt, int front)
+{
+    belt->front = front;
+    GLStateBindVertexArray(belt->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, belt->anomaly_VBO[front]);
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void *)0);
+    glEnableVertexAttribArray(3);
+    GLStateBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// orbits are uploaded a chunk at a time, so the staging stays in the scratch arena
+static int build(Belt *belt, const BeltPopulation *populations, int population_count,
+                 float catalogue_brightness, uint64_t seed)
+{
+    ArenaMarker mark = ArenaMark(&scratch_arena);
+    BeltOrbit *chunk = ArenaAlloc(&scratch_arena, BELT_UPLOAD_CHUNK * sizeof(BeltOrbit));
+    // one body whose axes are rederived for every particle
+    KeplerOrbits orbit;
+    OrbitalElements circle = {.semi_major_axis = 1};
+    if (!chunk || KeplerOrbitsInit(&orbit, 1) || KeplerOrbitsAdd(&orbit, &circle) < 0) {
+        perror("error allocating belt");
+        KeplerOrbitsFree(&orbit);
+        ArenaRelease(&scratch_arena, mark);
+        return 1;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, belt->orbit_VBO);
+    MemTrackBufferData(MEM_ORBITS, GL_ARRAY_BUFFER, belt->orbit_VBO, belt->count * sizeof(BeltOrbit), NULL,
+                       GL_STATIC_DRAW);
+    uint64_t state = seed;
+    int population = 0, left = population_count ? populations[0].count : 0;
+    int body = 0;
+    for (int start = 0; start < belt->count; start += BELT_UPLOAD_CHUNK) {
+        int n = belt->count - start < BELT_UPLOAD_CHUNK ? belt->count - start : BELT_UPLOAD_CHUNK;
+        for (int i = 0; i < n; i++) {
+            int k = start + i;
+            if (k >= belt->generated) {
+                body = next_body(belt, body);
+                OrbitalElements elements = catalogue_orbit(belt, body++);
+                KeplerOrbitsSet(&orbit, 0, &elements);
+                set_orbit(&chunk[i], &orbit, 0, catalogue_brightness);
+                continue;
+            }
+            while (!left)
+                left = populations[++population].count;
+            left--;
+            OrbitalElements elements = random_orbit(&populations[population], belt->gm, &state);
+            KeplerOrbitsSet(&orbit, 0, &elements);
+            set_orbit(&chunk[i], &orbit, 0, populations[population].brightness);
+            belt->mean_anomaly[k] = elements.mean_anomaly;
+            belt->mean_motion[k] = elements.mean_motion;
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, start * sizeof(BeltOrbit), n * sizeof(BeltOrbit), chunk);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    KeplerOrbitsFree(&orbit);
+    ArenaRelease(&scratch_arena, mark);
+    return 0;
+}
+
+int BeltInit(Belt *belt, const BeltPopulation *populations, int population_count, const Catalogue *catalogue,
+             float catalogue_brightness, double units_per_km, double gm, uint64_t seed, double time)
+{
+    *belt = (Belt) {
+        .catalogue = catalogue, .units_per_km = units_per_km, .gm = gm, .rebase_progress = -1, .epoch = time,
+    };
+    for (int i = 0; i < population_count; i++)
+        belt->generated += populations[i].count;
+    belt->count = belt->generated;
+    for (int k = 0; catalogue && k < catalogue->count; k++)
+        belt->count += BeltHasBody(catalogue, k);
+    belt->mean_anomaly = MemTrackAlloc(MEM_ORBITS, belt->generated * sizeof(double));
+    belt->mean_motion = MemTrackAlloc(MEM_ORBITS, belt->generated * sizeof(double));
+    if (belt->generated && (!belt->mean_anomaly || !belt->mean_motion)) {
+        perror("error allocating belt");
+        BeltDestroy(belt);
+        return 1;
+    }
+
+    glGenVertexArrays(1, &belt->VAO);
+    glGenBuffers(1, &belt->orbit_VBO);
+    glGenBuffers(2, belt->anomaly_VBO);
+    GLStateBindVertexArray(belt->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, belt->orbit_VBO);
+    // periapsis axis and eccentricity (location = 0), axis ahead and mean
+    // motion (location = 1), brightness (location = 2), and from the other
+    // buffer the mean anomaly at the epoch (location = 3)
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(BeltOrbit), (void *)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(BeltOrbit), (void *)(4 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(BeltOrbit), (void *)(8 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    GLStateBindVertexArray(0);
+    for (int i = 0; i < 2; i++) {
+        glBindBuffer(GL_ARRAY_BUFFER, belt->anomaly_VBO[i]);
+        MemTrackBufferData(MEM_ORBITS, GL_ARRAY_BUFFER, belt->anomaly_VBO[i], belt->count * sizeof(float), NULL,
+                           GL_DYNAMIC_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (build(belt, populations, population_count, catalogue_brightness, seed)) {
+        BeltDestroy(belt);
+        return 1;
+    }
+    FrameStatsNoteActivity(FRAME_ACTIVITY_MESH_UPLOAD);
+    for (int start = 0; start < belt->count; start += BELT_REBASE_SLICE) {
+        int end = belt->count - start < BELT_REBASE_SLICE ? belt->count : start + BELT_REBASE_SLICE;
+        upload_anomalies(belt, belt->anomaly_VBO[0], start, end, time);
+    }
+    point_at_anomalies(belt, 0);
+    return 0;
+}
+
+void BeltDestroy(Belt *belt)
+{
+    if (belt->orbit_VBO) {
+        MemTrackForgetBuffer(belt->orbit_VBO);
+        MemTrackForgetBuffer(belt->anomaly_VBO[0]);
+        MemTrackForgetBuffer(belt->anomaly_VBO[1]);
+        glDeleteBuffers(1, &belt->orbit_VBO);
+        glDeleteBuffers(2, belt->anomaly_VBO);
+        glDeleteVertexArrays(1, &belt->VAO);
+    }
+    MemTrackFree(MEM_ORBITS, belt->mean_anomaly);
+    MemTrackFree(MEM_ORBITS, belt->mean_motion);
+    *belt = (Belt) {0};
+}
+
+float BeltTime(Belt *belt, double time)
+{
+    if (belt->rebase_progress < 0 && fabs(time - belt->epoch) > BELT_REBASE_SPAN) {
+        belt->rebase_progress = 0;
+        belt->next_epoch = time;
+    }
+    if (belt->rebase_progress >= 0) {
+        int end = belt->count - belt->rebase_progress < BELT_REBASE_SLICE
+                ? belt->count : belt->rebase_progress + BELT_REBASE_SLICE;
+        upload_anomalies(belt, belt->anomaly_VBO[!belt->front], belt->rebase_progress, end, belt->next_epoch);
+        belt->rebase_progress = end;
+        if (end == belt->count) {
+            point_at_anomalies(belt, !belt->front);
+            belt->epoch = belt->next_epoch;
+            belt->rebase_progress = -1;
+        }
+    }
+    return time - belt->epoch;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "glad/glad.h"
+#include "kepler.h"
+#include "catalogue.h"
+
+// The asteroid and Kuiper belts as particles. Each particle is only its
+// orbit, uploaded once: the vertex shader solves Kepler's equation at the
+// current time and every population goes out in one GL_POINTS draw, so a
+// frame costs the CPU two uniforms however many particles there are.
+//
+// The catalogue's bodies about the Sun with no surface to draw are
+// particles too, read where they lie: from a mapped binary catalogue no
+// per-body copy is made on the CPU, their axes go straight into the
+// upload and their mean motions are recomputed when needed.
+//
+// The shader works in float, so mean anomalies are kept in a buffer of
+// their own, referred to an epoch near the current time. Once the
+// simulation drifts BELT_REBASE_SPAN away, new anomalies are worked out
+// in double from each particle's anomaly at time 0, BELT_REBASE_SLICE
+// particles a frame through the frame arena, into the second of two
+// anomaly buffers; the draw switches over once it is full. Nothing is
+// regenerated, and the old epoch stays good far longer than that takes.
+#define BELT_REBASE_SPAN (100 * 365.25 * 86400.0)
+#define BELT_REBASE_SLICE 32768
+#define BELT_UPLOAD_CHUNK 16384     // orbits built and uploaded at a time, through the scratch arena
+
+typedef struct {
+    int count;
+    double inner, outer;        // semi-major axis range, world units
+    double eccentricity;        // largest
+    double inclination;         // typical, radians
+    float brightness;
+    const double *gaps;         // semi-major axes left empty, such as resonances
+    int gap_count;
+    double gap_half_width;
+} BeltPopulation;
+
+// the part of a particle that never changes
+typedef struct {
+    float periapsis[3];         // orbit-plane axis towards periapsis, times a
+    float eccentricity;
+    float ahead[3];             // 90 degrees ahead, times b
+    float mean_motion;
+    float brightness;
+} BeltOrbit;
+
+typedef struct {
+    GLuint VAO;
+    GLuint orbit_VBO;           // BeltOrbit per particle
+    GLuint anomaly_VBO[2];      // mean anomaly at the epoch per particle, and the next epoch's
+    int front;                  // the anomaly buffer being drawn
+    int count;
+    int generated;              // particles from the populations, the catalogue's follow
+    double epoch;               // simulation time the mean anomalies refer to
+
+    // generated particles at time 0, what a rebase starts from
+    double *mean_anomaly;
+    double *mean_motion;
+    const Catalogue *catalogue; // read in place, may be NULL
+    double units_per_km;
+    double gm;                  // of the Sun, world units
+    int cursor;                 // catalogue body of the next particle a rebase reaches
+
+    int rebase_progress;        // particles done, -1 when no rebase is under way
+    double next_epoch;
+} Belt;
+
+// whether the body is drawn as a belt particle rather than on its own
+bool BeltHasBody(const Catalogue *catalogue, int body);
+// the catalogue is kept by pointer and read again on every rebase; on
+// failure the belt is left empty
+int BeltInit(Belt *belt, const BeltPopulation *populations, int population_count, const Catalogue *catalogue,
+             float catalogue_brightness, double units_per_km, double gm, uint64_t seed, double time);
+void BeltDestroy(Belt *belt);
+// the time to give the shader; advances a rebase when one is due
+float BeltTime(Belt *belt, double time);
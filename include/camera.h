@@ -19,8 +19,12 @@ enum Camera_Movement {
 #define SENSITIVITY 0.1f
 #define ZOOM        45.0f
 
+// The position is kept in double and never reaches the GPU: the view
+// matrix only rotates, and everything drawn is first moved into
+// camera-relative floats with CameraRelative(), so precision is best
+// right in front of the viewer however far out in the system it is.
 typedef struct Camera {
-    vec3 Position;
+    double Position[3];
     vec3 Front;
     vec3 Up;
     vec3 Right;
@@ -34,8 +38,9 @@ typedef struct Camera {
 
 static inline void updateCameraVectors(Camera* cam);
 
-static inline void Camera_init(Camera* cam, vec3 position, vec3 up, float yaw, float pitch) {
-    glm_vec3_copy(position, cam->Position);
+static inline void Camera_init(Camera* cam, const double position[3], vec3 up, float yaw, float pitch) {
+    for (int i = 0; i < 3; i++)
+        cam->Position[i] = position[i];
     glm_vec3_copy(up, cam->WorldUp);
     cam->Yaw = yaw;
     cam->Pitch = pitch;
@@ -46,37 +51,47 @@ static inline void Camera_init(Camera* cam, vec3 position, vec3 up, float yaw, f
     updateCameraVectors(cam);
 }
 
-static inline void Camera_initPos(Camera* cam, float posX, float posY, float posZ, 
+static inline void Camera_initPos(Camera* cam, double posX, double posY, double posZ, 
                                  float upX, float upY, float upZ, float yaw, float pitch) {
-    Camera_init(cam, (vec3){posX, posY, posZ}, (vec3){upX, upY, upZ}, yaw, pitch);
+    Camera_init(cam, (double[3]){posX, posY, posZ}, (vec3){upX, upY, upZ}, yaw, pitch);
 }
 
+// camera at the origin, see CameraRelative()
 static inline void GetViewMatrix(Camera* cam, mat4 out) {
-    vec3 center;
-    glm_vec3_add(cam->Position, cam->Front, center);
-    glm_lookat(cam->Position, center, cam->Up, out);
+    glm_lookat((vec3){0.0f, 0.0f, 0.0f}, cam->Front, cam->Up, out);
+}
+
+// world position, in double, to the float offset from the camera that rendering uses
+static inline void CameraRelative(const Camera* cam, const double world[3], vec3 out) {
+    for (int i = 0; i < 3; i++)
+        out[i] = (float)(world[i] - cam->Position[i]);
+}
+
+static inline void CameraMove(Camera* cam, vec3 direction, double distance) {
+    for (int i = 0; i < 3; i++)
+        cam->Position[i] += direction[i] * distance;
 }
 
 static inline void ProcessKeyboard(Camera* cam, enum Camera_Movement direction, float deltaTime) {
-    float velocity = cam->MovementSpeed * deltaTime;
+    double velocity = (double)cam->MovementSpeed * deltaTime;
     switch (direction) {
         case FORWARD:
-            glm_vec3_muladds(cam->Front, velocity, cam->Position);
+            CameraMove(cam, cam->Front, velocity);
             break;
         case BACKWARD:
-            glm_vec3_muladds(cam->Front, -velocity, cam->Position);
+            CameraMove(cam, cam->Front, -velocity);
             break;
         case LEFT:
-            glm_vec3_muladds(cam->Right, -velocity, cam->Position);
+            CameraMove(cam, cam->Right, -velocity);
             break;
         case RIGHT:
-            glm_vec3_muladds(cam->Right, velocity, cam->Position);
+            CameraMove(cam, cam->Right, velocity);
             break;
         case UP:
-            glm_vec3_muladds(cam->Up, velocity, cam->Position);
+            CameraMove(cam, cam->Up, velocity);
             break;
         case DOWN:
-            glm_vec3_muladds(cam->Up, -velocity, cam->Position);
+            CameraMove(cam, cam->Up, -velocity);
             break;
     }
 }
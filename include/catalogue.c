@@ -0,0 +1,621 @@
+#include <fcntl.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "catalogue.h"
+#include "arena.h"
+#include "mem_track.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define CATALOGUE_BODY_COLUMNS 13     // then strings, textures and the lookup table
+#define CATALOGUE_COLUMNS 16
+#define CATALOGUE_FIELDS 13
+
+static const char *kind_names[BODY_KIND_COUNT] = {"planet", "dwarf", "moon", "asteroid"};
+
+typedef struct {
+    const char *start;
+    size_t length;
+} Token;
+
+
+// every array with its element size, the per-body ones first; also the
+// column order of the binary format
+static void columns(Catalogue *catalogue, void **out[CATALOGUE_COLUMNS], size_t sizes[CATALOGUE_COLUMNS])
+{
+    void **all[CATALOGUE_COLUMNS] = {
+        (void **)&catalogue->kind, (void **)&catalogue->parent, (void **)&catalogue->name,
+        (void **)&catalogue->texture, (void **)&catalogue->semi_major_axis, (void **)&catalogue->eccentricity,
+        (void **)&catalogue->inclination, (void **)&catalogue->ascending_node,
+        (void **)&catalogue->argument_periapsis, (void **)&catalogue->mean_anomaly, (void **)&catalogue->gm,
+        (void **)&catalogue->radius, (void **)&catalogue->rotation,
+        (void **)&catalogue->strings, (void **)&catalogue->textures, (void **)&catalogue->lookup,
+    };
+    size_t all_sizes[CATALOGUE_COLUMNS] = {
+        sizeof(unsigned char), sizeof(int), sizeof(uint32_t), sizeof(int),
+        sizeof(double), sizeof(double), sizeof(double), sizeof(double), sizeof(double), sizeof(double),
+        sizeof(double), sizeof(float), sizeof(float),
+        sizeof(char), sizeof(uint32_t), sizeof(int),
+    };
+    for (int c = 0; c < CATALOGUE_COLUMNS; c++) {
+        out[c] = all[c];
+        sizes[c] = all_sizes[c];
+    }
+}
+
+static int reserve(Catalogue *catalogue, int capacity)
+{
+    if (capacity <= catalogue->capacity)
+        return 0;
+    void **column[CATALOGUE_COLUMNS];
+    size_t size[CATALOGUE_COLUMNS];
+    columns(catalogue, column, size);
+    for (int c = 0; c < CATALOGUE_BODY_COLUMNS; c++) {
+        void *grown = MemTrackRealloc(MEM_SIMULATION, *column[c], capacity * size[c]);
+        if (!grown) {
+            perror("error allocating catalogue");
+            return 1;
+        }
+        *column[c] = grown;
+    }
+    catalogue->capacity = capacity;
+    return 0;
+}
+
+static uint32_t add_string(Catalogue *catalogue, Token token)
+{
+    size_t needed = catalogue->strings_size + token.length + 1;
+    if (needed > catalogue->strings_capacity) {
+        size_t capacity = catalogue->strings_capacity * 2 > needed ? catalogue->strings_capacity * 2 : needed;
+        char *grown = MemTrackRealloc(MEM_SIMULATION, catalogue->strings, capacity);
+        if (!grown) {
+            perror("error allocating catalogue");
+            return 0;
+        }
+        catalogue->strings = grown;
+        catalogue->strings_capacity = capacity;
+    }
+    uint32_t offset = catalogue->strings_size;
+    memcpy(catalogue->strings + offset, token.start, token.length);
+    catalogue->strings[offset + token.length] = '\0';
+    catalogue->strings_size = needed;
+    return offset;
+}
+
+static uint32_t hash(const char *s, size_t length)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static bool token_is(Token token, const char *s)
+{
+    return strlen(s) == token.length && memcmp(token.start, s, token.length) == 0;
+}
+
+// the lookup slot holding the name, or the empty slot where it would go
+static int *lookup_slot(const Catalogue *catalogue, const char *name, size_t length)
+{
+    int mask = catalogue->lookup_capacity - 1;
+    for (uint32_t i = hash(name, length);; i++) {
+        int *slot = &catalogue->lookup[i & mask];
+        if (*slot < 0)
+            return slot;
+        const char *other = catalogue->strings + catalogue->name[*slot];
+        if (strncmp(other, name, length) == 0 && other[length] == '\0')
+            return slot;
+    }
+}
+
+static int grow_lookup(Catalogue *catalogue)
+{
+    int capacity = catalogue->lookup_capacity ? catalogue->lookup_capacity * 2 : 64;
+    int *table = MemTrackAlloc(MEM_SIMULATION, capacity * sizeof(int));
+    if (!table) {
+        perror("error allocating catalogue");
+        return 1;
+    }
+    int *old = catalogue->lookup;
+    int old_capacity = catalogue->lookup_capacity;
+    for (int i = 0; i < capacity; i++)
+        table[i] = -1;
+    catalogue->lookup = table;
+    catalogue->lookup_capacity = capacity;
+    for (int i = 0; i < old_capacity; i++) {
+        if (old[i] < 0)
+            continue;
+        const char *name = catalogue->strings + catalogue->name[old[i]];
+        *lookup_slot(catalogue, name, strlen(name)) = old[i];
+    }
+    MemTrackFree(MEM_SIMULATION, old);
+    return 0;
+}
+
+static int find(const Catalogue *catalogue, const char *name, size_t length)
+{
+    if (!catalogue->lookup_capacity)
+        return -1;
+    return *lookup_slot(catalogue, name, length);
+}
+
+static int add_texture(Catalogue *catalogue, Token path)
+{
+    for (int t = 0; t < catalogue->texture_count; t++) {
+        const char *other = catalogue->strings + catalogue->textures[t];
+        if (strncmp(other, path.start, path.length) == 0 && other[path.length] == '\0')
+            return t;
+    }
+    uint32_t *grown = MemTrackRealloc(MEM_SIMULATION, catalogue->textures,
+                                      (catalogue->texture_count + 1) * sizeof(uint32_t));
+    if (!grown) {
+        perror("error allocating catalogue");
+        return -1;
+    }
+    catalogue->textures = grown;
+    catalogue->textures[catalogue->texture_count] = add_string(catalogue, path);
+    return catalogue->texture_count++;
+}
+
+// Decimal numbers of up to 19 significant digits with an exponent a power
+// of ten can carry exactly are one correctly rounded multiply or divide;
+// anything else goes to strtod.
+static bool parse_number(Token token, double *out)
+{
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+    const char *p = token.start, *end = token.start + token.length;
+    bool negative = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+'))
+        p++;
+    uint64_t mantissa = 0;
+    int significant = 0, exponent = 0, digits = 0;
+    bool exact = true;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+        if (significant < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            significant += mantissa != 0;
+        } else {
+            exponent++;
+            exact = false;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+            if (significant < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                significant += mantissa != 0;
+                exponent--;
+            } else {
+                exact = false;
+            }
+        }
+    }
+    if (!digits)
+        return false;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negative_exponent = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+'))
+            p++;
+        if (p == end)
+            return false;
+        int value = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++)
+            value = value < 10000 ? value * 10 + (*p - '0') : value;
+        exponent += negative_exponent ? -value : value;
+    }
+    if (p != end)
+        return false;
+
+    if (exact && mantissa < (1ull << 53) && exponent >= -22 && exponent <= 22) {
+        double value = (double)mantissa;
+        value = exponent < 0 ? value / powers[-exponent] : value * powers[exponent];
+        *out = negative ? -value : value;
+        return true;
+    }
+    char copy[64];
+    if (token.length >= sizeof(copy))
+        return false;
+    memcpy(copy, token.start, token.length);
+    copy[token.length] = '\0';
+    *out = strtod(copy, NULL);
+    return true;
+}
+
+static int split(const char *p, const char *end, Token *tokens, int max)
+{
+    int count = 0;
+    for (;;) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+            p++;
+        if (p == end)
+            return count;
+        if (count == max)
+            return max + 1;
+        const char *start = p;
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\r')
+            p++;
+        tokens[count++] = (Token) {start, p - start};
+    }
+}
+
+// 0 for a body or a blank line, 1 for a line that was skipped
+static int parse_line(Catalogue *catalogue, const char *p, const char *end, const char *path, int line)
+{
+    const char *comment = memchr(p, '#', end - p);
+    if (comment)
+        end = comment;
+    Token field[CATALOGUE_FIELDS];
+    int count = split(p, end, field, CATALOGUE_FIELDS);
+    if (!count)
+        return 0;
+    if (count != CATALOGUE_FIELDS) {
+        fprintf(stderr, "%s:%d: expected %d columns\n", path, line, CATALOGUE_FIELDS);
+        return 1;
+    }
+
+    int kind = 0;
+    while (kind < BODY_KIND_COUNT && !token_is(field[0], kind_names[kind]))
+        kind++;
+    if (kind == BODY_KIND_COUNT) {
+        fprintf(stderr, "%s:%d: unknown kind '%.*s'\n", path, line, (int)field[0].length, field[0].start);
+        return 1;
+    }
+    bool named = !token_is(field[1], "-");
+    if (named && find(catalogue, field[1].start, field[1].length) >= 0) {
+        fprintf(stderr, "%s:%d: '%.*s' is listed twice\n", path, line, (int)field[1].length, field[1].start);
+        return 1;
+    }
+    int parent = -1;
+    if (!token_is(field[2], "Sun")) {
+        parent = find(catalogue, field[2].start, field[2].length);
+        if (parent < 0) {
+            fprintf(stderr, "%s:%d: parent '%.*s' is not listed above\n", path, line,
+                    (int)field[2].length, field[2].start);
+            return 1;
+        }
+    }
+    double value[9];
+    for (int i = 0; i < 9; i++) {
+        if (!parse_number(field[3 + i], &value[i]) || !isfinite(value[i])) {
+            fprintf(stderr, "%s:%d: '%.*s' is not a number\n", path, line,
+                    (int)field[3 + i].length, field[3 + i].start);
+            return 1;
+        }
+    }
+    if (!(value[0] > 0) || !(value[1] >= 0 && value[1] < 1) || value[6] < 0 || value[7] < 0) {
+        fprintf(stderr, "%s:%d: not a bound orbit with a positive size and mass\n", path, line);
+        return 1;
+    }
+
+    if (catalogue->count == catalogue->capacity && reserve(catalogue, catalogue->capacity * 2))
+        return 1;
+    int k = catalogue->count;
+    catalogue->kind[k] = kind;
+    catalogue->parent[k] = parent;
+    catalogue->name[k] = named ? add_string(catalogue, field[1]) : 0;
+    catalogue->texture[k] = token_is(field[12], "-") ? -1 : add_texture(catalogue, field[12]);
+    catalogue->semi_major_axis[k] = value[0];
+    catalogue->eccentricity[k] = value[1];
+    catalogue->inclination[k] = value[2] * (M_PI / 180);
+    catalogue->ascending_node[k] = value[3] * (M_PI / 180);
+    catalogue->argument_periapsis[k] = value[4] * (M_PI / 180);
+    catalogue->mean_anomaly[k] = value[5] * (M_PI / 180);
+    catalogue->radius[k] = value[6];
+    catalogue->gm[k] = value[7];
+    catalogue->rotation[k] = value[8];
+    catalogue->count++;
+
+    if (named) {
+        if (2 * (catalogue->lookup_count + 1) > catalogue->lookup_capacity && grow_lookup(catalogue))
+            return 1;
+        *lookup_slot(catalogue, field[1].start, field[1].length) = k;
+        catalogue->lookup_count++;
+    }
+    return 0;
+}
+
+int CatalogueLoad(Catalogue *catalogue, const char *path)
+{
+    *catalogue = (Catalogue) {.owned = ~0u};
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return 1;
+    }
+    // offset 0 is the empty string, the name of unnamed bodies
+    add_string(catalogue, (Token) {"", 0});
+    if (reserve(catalogue, 64) || !catalogue->strings) {
+        fclose(file);
+        return 1;
+    }
+
+    ArenaMarker mark = ArenaMark(&scratch_arena);
+    char *buffer = ArenaAlloc(&scratch_arena, CATALOGUE_CHUNK);
+    size_t filled = 0;
+    int line = 0, skipped = 0;
+    for (;;) {
+        if (filled == CATALOGUE_CHUNK) {
+            fprintf(stderr, "%s:%d: line longer than %u bytes\n", path, line + 1, CATALOGUE_CHUNK);
+            fclose(file);
+            ArenaRelease(&scratch_arena, mark);
+            return 1;
+        }
+        size_t got = fread(buffer + filled, 1, CATALOGUE_CHUNK - filled, file);
+        filled += got;
+        bool last = got == 0;
+        const char *cursor = buffer, *end = buffer + filled;
+        for (;;) {
+            const char *newline = memchr(cursor, '\n', end - cursor);
+            if (!newline) {
+                // a partial line waits for the next chunk, unless there is none
+                if (!last || cursor == end)
+                    break;
+                newline = end;
+            }
+            skipped += parse_line(catalogue, cursor, newline, path, ++line);
+            cursor = newline == end ? end : newline + 1;
+        }
+        filled = end - cursor;
+        memmove(buffer, cursor, filled);
+        if (last)
+            break;
+    }
+    bool failed = ferror(file);
+    fclose(file);
+    ArenaRelease(&scratch_arena, mark);
+    if (failed) {
+        fprintf(stderr, "%s: read error\n", path);
+        return 1;
+    }
+    printf("catalogue: %d bodies and %d textures from %s", catalogue->count, catalogue->texture_count, path);
+    if (skipped)
+        printf(", %d lines skipped", skipped);
+    printf("\n");
+    return 0;
+}
+
+void CatalogueFree(Catalogue *catalogue)
+{
+    void **column[CATALOGUE_COLUMNS];
+    size_t size[CATALOGUE_COLUMNS];
+    columns(catalogue, column, size);
+    for (int c = 0; c < CATALOGUE_COLUMNS; c++) {
+        if (catalogue->owned & (1u << c))
+            MemTrackFree(MEM_SIMULATION, *column[c]);
+    }
+    if (catalogue->mapping)
+        munmap(catalogue->mapping, catalogue->mapping_size);
+    *catalogue = (Catalogue) {0};
+}
+
+uint64_t CatalogueKey(const char *path)
+{
+    struct stat st;
+    if (stat(path, &st))
+        return 0;
+    // nanoseconds too, so an edit of the same size within a second still counts
+    uint64_t fields[3] = {st.st_size, st.st_mtim.tv_sec, st.st_mtim.tv_nsec};
+    uint64_t key = 14695981039346656037ull;
+    for (int i = 0; i < 3; i++)
+        key = (key ^ fields[i]) * 0x100000001B3ull;
+    return key ? key : 1;
+}
+
+// elements in each column of the binary format
+static void column_counts(const Catalogue *catalogue, uint64_t counts[CATALOGUE_COLUMNS])
+{
+    for (int c = 0; c < CATALOGUE_BODY_COLUMNS; c++)
+        counts[c] = catalogue->count;
+    counts[CATALOGUE_BODY_COLUMNS] = catalogue->strings_size;
+    counts[CATALOGUE_BODY_COLUMNS + 1] = catalogue->texture_count;
+    counts[CATALOGUE_BODY_COLUMNS + 2] = catalogue->lookup_capacity;
+}
+
+// bytes the column takes run-length encoded, written out too when file is set
+static size_t run_length(const unsigned char *data, size_t count, size_t element, FILE *file)
+{
+    size_t size = 0;
+    for (size_t i = 0; i < count;) {
+        size_t j = i + 1;
+        while (j < count && j - i < UINT32_MAX && memcmp(data + j * element, data + i * element, element) == 0)
+            j++;
+        uint32_t run = j - i;
+        if (file && (fwrite(&run, sizeof(run), 1, file) != 1 || fwrite(data + i * element, element, 1, file) != 1))
+            return 0;
+        size += sizeof(run) + element;
+        i = j;
+    }
+    return size;
+}
+
+int CatalogueSave(const Catalogue *catalogue, const char *path, uint64_t key)
+{
+    void **column[CATALOGUE_COLUMNS];
+    size_t size[CATALOGUE_COLUMNS];
+    uint64_t count[CATALOGUE_COLUMNS];
+    columns((Catalogue *)catalogue, column, size);
+    column_counts(catalogue, count);
+
+    CatalogueHeader header = {
+        {'S', 'C', 'A', 'T'}, CATALOGUE_VERSION, key, catalogue->count, catalogue->texture_count,
+        catalogue->lookup_capacity, catalogue->lookup_count, catalogue->strings_size, CATALOGUE_COLUMNS, 0,
+    };
+    CatalogueColumn directory[CATALOGUE_COLUMNS];
+    uint64_t offset = sizeof(header) + sizeof(directory);
+    for (int c = 0; c < CATALOGUE_COLUMNS; c++) {
+        size_t raw = count[c] * size[c];
+        // only the per-body columns have runs worth the decoding
+        size_t encoded = c < CATALOGUE_BODY_COLUMNS ? run_length(*column[c], count[c], size[c], NULL) : raw;
+        bool rle = encoded * CATALOGUE_RLE_GAIN <= raw;
+        offset = (offset + CATALOGUE_ALIGNMENT - 1) / CATALOGUE_ALIGNMENT * CATALOGUE_ALIGNMENT;
+        directory[c] = (CatalogueColumn) {
+            rle ? CATALOGUE_RLE : CATALOGUE_RAW, size[c], count[c], offset, rle ? encoded : raw,
+        };
+        offset += directory[c].size;
+    }
+
+    // written aside and renamed over like the ephemeris, the parent is ours to create
+    char tmp_path[256];
+    snprintf(tmp_path, sizeof(tmp_path), "%s", path);
+    char *slash = strrchr(tmp_path, '/');
+    if (slash) {
+        *slash = '\0';
+        mkdir(tmp_path, 0755);
+    }
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *file = fopen(tmp_path, "wb");
+    bool ok = file && fwrite(&header, sizeof(header), 1, file) == 1
+           && fwrite(directory, sizeof(directory), 1, file) == 1;
+    uint64_t position = sizeof(header) + sizeof(directory);
+    static const char padding[CATALOGUE_ALIGNMENT];
+    for (int c = 0; ok && c < CATALOGUE_COLUMNS; c++) {
+        size_t pad = directory[c].offset - position;
+        ok = fwrite(padding, 1, pad, file) == pad;
+        if (directory[c].encoding == CATALOGUE_RLE)
+            ok = ok && run_length(*column[c], count[c], size[c], file) == directory[c].size;
+        else if (directory[c].size)
+            ok = ok && fwrite(*column[c], directory[c].size, 1, file) == 1;
+        position = directory[c].offset + directory[c].size;
+    }
+    if (file)
+        ok = fclose(file) == 0 && ok;
+    if (!ok || rename(tmp_path, path)) {
+        fprintf(stderr, "catalogue: error writing %s\n", path);
+        remove(tmp_path);
+        return 1;
+    }
+    return 0;
+}
+
+static bool decode(const unsigned char *in, size_t size, unsigned char *out, size_t count, size_t element)
+{
+    size_t filled = 0;
+    for (size_t at = 0; at < size; at += sizeof(uint32_t) + element) {
+        uint32_t run;
+        if (size - at < sizeof(run) + element)
+            return false;
+        memcpy(&run, in + at, sizeof(run));
+        if (run > count - filled)
+            return false;
+        for (uint32_t i = 0; i < run; i++)
+            memcpy(out + (filled + i) * element, in + at + sizeof(run), element);
+        filled += run;
+    }
+    return filled == count;
+}
+
+int CatalogueOpen(Catalogue *catalogue, const char *path, uint64_t key)
+{
+    *catalogue = (Catalogue) {0};
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return 1;
+    struct stat st;
+    if (fstat(fd, &st) || (size_t)st.st_size < sizeof(CatalogueHeader) + CATALOGUE_COLUMNS * sizeof(CatalogueColumn)) {
+        close(fd);
+        return 1;
+    }
+    void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror(path);
+        return 1;
+    }
+    const CatalogueHeader *header = mapping;
+    if (memcmp(header->magic, "SCAT", 4) != 0 || header->version != CATALOGUE_VERSION
+        || (key && header->key != key) || header->column_count != CATALOGUE_COLUMNS) {
+        munmap(mapping, st.st_size);
+        return 1;
+    }
+    catalogue->mapping = mapping;
+    catalogue->mapping_size = st.st_size;
+    catalogue->count = catalogue->capacity = header->body_count;
+    catalogue->strings_size = catalogue->strings_capacity = header->strings_size;
+    catalogue->texture_count = header->texture_count;
+    catalogue->lookup_capacity = header->lookup_capacity;
+    catalogue->lookup_count = header->lookup_count;
+
+    // the layout is checked first
+    void **column[CATALOGUE_COLUMNS];
+    size_t size[CATALOGUE_COLUMNS];
+    uint64_t count[CATALOGUE_COLUMNS];
+    columns(catalogue, column, size);
+    column_counts(catalogue, count);
+    const CatalogueColumn *directory = (const CatalogueColumn *)(header + 1);
+    bool ok = (catalogue->lookup_capacity & (catalogue->lookup_capacity - 1)) == 0
+           && catalogue->lookup_count < catalogue->lookup_capacity + (catalogue->lookup_capacity == 0);
+    for (int c = 0; ok && c < CATALOGUE_COLUMNS; c++) {
+        const CatalogueColumn *entry = &directory[c];
+        ok = entry->element_size == size[c] && entry->count == count[c]
+          && entry->offset % CATALOGUE_ALIGNMENT == 0 && entry->offset <= (uint64_t)st.st_size
+          && entry->size <= (uint64_t)st.st_size - entry->offset;
+        if (!ok)
+            break;
+        const unsigned char *data = (const unsigned char *)mapping + entry->offset;
+        if (entry->encoding == CATALOGUE_RAW) {
+            ok = entry->size == count[c] * size[c];
+            *column[c] = count[c] ? (void *)data : NULL;
+        } else if (entry->encoding == CATALOGUE_RLE && count[c]) {
+            *column[c] = MemTrackAlloc(MEM_SIMULATION, count[c] * size[c]);
+            if (!*column[c]) {
+                perror("error allocating catalogue");
+                ok = false;
+                break;
+            }
+            catalogue->owned |= 1u << c;
+            ok = decode(data, entry->size, *column[c], count[c], size[c]);
+        } else {
+            ok = entry->encoding == CATALOGUE_RLE;
+        }
+    }
+    ok = ok && catalogue->strings_size && catalogue->strings[catalogue->strings_size - 1] == '\0';
+    // and the indices hold to what CatalogueLoad enforces: parents come first
+    for (int k = 0; ok && k < catalogue->count; k++)
+        ok = catalogue->kind[k] < BODY_KIND_COUNT
+          && catalogue->parent[k] >= -1 && catalogue->parent[k] < k
+          && catalogue->texture[k] >= -1 && catalogue->texture[k] < catalogue->texture_count
+          && catalogue->name[k] < catalogue->strings_size;
+    for (int t = 0; ok && t < catalogue->texture_count; t++)
+        ok = catalogue->textures[t] < catalogue->strings_size;
+    for (int s = 0; ok && s < catalogue->lookup_capacity; s++)
+        ok = catalogue->lookup[s] >= -1 && catalogue->lookup[s] < catalogue->count;
+    if (!ok) {
+        fprintf(stderr, "%s: malformed catalogue\n", path);
+        CatalogueFree(catalogue);
+        return 1;
+    }
+    madvise(mapping, st.st_size, MADV_WILLNEED);
+    printf("catalogue: %d bodies and %d textures mapped from %s\n", catalogue->count, catalogue->texture_count, path);
+    return 0;
+}
+
+int CatalogueFind(const Catalogue *catalogue, const char *name)
+{
+    return find(catalogue, name, strlen(name));
+}
+
+const char *CatalogueName(const Catalogue *catalogue, int body)
+{
+    return catalogue->strings + catalogue->name[body];
+}
+
+const char *CatalogueTexture(const Catalogue *catalogue, int texture)
+{
+    return catalogue->strings + catalogue->textures[texture];
+}
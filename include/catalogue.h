@@ -0,0 +1,122 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// The bodies of the system, read from a text catalogue: one body per line,
+// whitespace-separated columns, '#' to the end of a line is a comment.
+//
+//   kind name parent a e i node peri M radius gm rotation texture
+//
+//   kind       planet, dwarf, moon or asteroid
+//   name       no spaces, '-' for none; a parent must be named
+//   parent     name of a body listed earlier, or Sun
+//   a          semi-major axis, km
+//   e i node peri M
+//              eccentricity, inclination, longitude of the ascending
+//              node, argument of periapsis and mean anomaly at J2000, in
+//              degrees, referred to the ecliptic
+//   radius     mean radius, km
+//   gm         gravitational parameter, km^3/s^2
+//   rotation   spin, as the equatorial speed in km/h
+//   texture    image for the body's surface, '-' for a point-like body
+//
+// The file is streamed through a fixed buffer and numbers are parsed by
+// hand, falling back to strtod only past 19 significant digits or a power
+// of ten beyond 1e22, so millions of small bodies load in about a second.
+// Storage is one array per column, grown by doubling.
+//
+// The same columns can be saved to a binary file and mapped back in, which
+// skips parsing altogether: a header, a directory with one entry per
+// column, and each column as one aligned array. Most columns are stored
+// raw and used straight from the mapping, read-only; a column that is
+// constant or made of long runs (kind, parent, texture and rotation of a
+// million unnamed asteroids) may be run-length encoded instead and is then
+// decoded into memory of its own on open. Byte order is the machine's.
+#define CATALOGUE_CHUNK (1u << 20)
+#define CATALOGUE_VERSION 1
+#define CATALOGUE_ALIGNMENT 64      // of every column in a binary catalogue
+#define CATALOGUE_RLE_GAIN 4        // a column is encoded when that shrinks it at least this many times
+
+typedef enum {
+    BODY_PLANET,
+    BODY_DWARF,
+    BODY_MOON,
+    BODY_ASTEROID,
+    BODY_KIND_COUNT
+} BodyKind;
+
+typedef struct {
+    int count;
+    int capacity;
+
+    unsigned char *kind;        // BodyKind
+    int *parent;                // index of the parent, -1 for the Sun
+    uint32_t *name;             // offset into strings, 0 for none
+    int *texture;               // index into textures, -1 for none
+    double *semi_major_axis;    // km
+    double *eccentricity;
+    double *inclination;        // radians from here on
+    double *ascending_node;
+    double *argument_periapsis;
+    double *mean_anomaly;
+    double *gm;                 // km^3/s^2
+    float *radius;              // km
+    float *rotation;            // km/h at the equator
+
+    char *strings;              // names and texture paths, NUL-terminated
+    size_t strings_size;
+    size_t strings_capacity;
+    uint32_t *textures;         // offsets into strings of each distinct texture
+    int texture_count;
+
+    int *lookup;                // open-addressed name -> body table
+    int lookup_capacity;
+    int lookup_count;
+
+    uint32_t owned;             // bit per column allocated here rather than mapped
+    void *mapping;              // the binary catalogue the other columns point into
+    size_t mapping_size;
+} Catalogue;
+
+typedef enum {
+    CATALOGUE_RAW,
+    CATALOGUE_RLE,              // (uint32_t run, element) pairs
+} CatalogueEncoding;
+
+typedef struct {
+    char magic[4];              // "SCAT"
+    uint32_t version;
+    uint64_t key;               // of the text the file was made from, see CatalogueKey
+    uint32_t body_count;
+    uint32_t texture_count;
+    uint32_t lookup_capacity;
+    uint32_t lookup_count;
+    uint64_t strings_size;
+    uint32_t column_count;
+    uint32_t reserved;
+} CatalogueHeader;
+
+typedef struct {
+    uint32_t encoding;          // CatalogueEncoding
+    uint32_t element_size;
+    uint64_t count;             // elements once decoded
+    uint64_t offset;            // from the start of the file
+    uint64_t size;              // bytes stored
+} CatalogueColumn;
+
+// 0 on success; lines that fail to parse are reported and skipped
+int CatalogueLoad(Catalogue *catalogue, const char *path);
+void CatalogueFree(Catalogue *catalogue);
+
+// identifies a text catalogue by its size and modification time to the
+// nanosecond, 0 if it cannot be read
+uint64_t CatalogueKey(const char *path);
+int CatalogueSave(const Catalogue *catalogue, const char *path, uint64_t key);
+// 0 on success; fails quietly when the file is missing or its key differs,
+// unless key is 0
+int CatalogueOpen(Catalogue *catalogue, const char *path, uint64_t key);
+
+// body index by name, or -1
+int CatalogueFind(const Catalogue *catalogue, const char *name);
+const char *CatalogueName(const Catalogue *catalogue, int body);
+const char *CatalogueTexture(const Catalogue *catalogue, int texture);
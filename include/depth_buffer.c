@@ -0,0 +1,128 @@
+#include <math.h>
+#include <stdio.h>
+
+#include "depth_buffer.h"
+#include "gl_caps.h"
+#include "mem_track.h"
+#include "shader_s.h"
+
+
+static int create_targets(DepthBuffer *depth)
+{
+    glGenFramebuffers(1, &depth->framebuffer);
+    glGenRenderbuffers(1, &depth->color);
+    glGenRenderbuffers(1, &depth->depth);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, depth->color);
+    MemTrackRenderbufferStorage(MEM_RENDERER, depth->color, GL_RGBA8, depth->width, depth->height, 4);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth->depth);
+    MemTrackRenderbufferStorage(MEM_RENDERER, depth->depth, GL_DEPTH_COMPONENT32F, depth->width, depth->height, 4);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, depth->framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, depth->color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth->depth);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "depth buffer: framebuffer incomplete (0x%x)\n", status);
+        return 1;
+    }
+    return 0;
+}
+
+static void destroy_targets(DepthBuffer *depth)
+{
+    if (!depth->framebuffer)
+        return;
+    MemTrackForgetRenderbuffer(depth->color);
+    MemTrackForgetRenderbuffer(depth->depth);
+    glDeleteRenderbuffers(1, &depth->color);
+    glDeleteRenderbuffers(1, &depth->depth);
+    glDeleteFramebuffers(1, &depth->framebuffer);
+    depth->framebuffer = depth->color = depth->depth = 0;
+}
+
+int DepthBufferInit(DepthBuffer *depth, int width, int height, float near_plane, float far_plane)
+{
+    *depth = (DepthBuffer) {
+        .mode = DEPTH_LOGARITHMIC, .width = width, .height = height,
+        .near_plane = near_plane, .far_plane = far_plane,
+    };
+    if (gl_caps.clip_control) {
+        if (!create_targets(depth)) {
+            depth->mode = DEPTH_REVERSED_Z;
+            glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+        } else {
+            destroy_targets(depth);
+        }
+    }
+    printf("depth buffer: %s\n", depth->mode == DEPTH_REVERSED_Z
+           ? "reversed-Z, 32-bit float" : "logarithmic, written by the vertex shaders");
+    return 0;
+}
+
+void DepthBufferResize(DepthBuffer *depth, int width, int height)
+{
+    depth->width = width;
+    depth->height = height;
+    if (depth->mode != DEPTH_REVERSED_Z)
+        return;
+    destroy_targets(depth);
+    create_targets(depth);
+}
+
+void DepthBufferDestroy(DepthBuffer *depth)
+{
+    destroy_targets(depth);
+}
+
+unsigned int DepthBufferShaderFeatures(const DepthBuffer *depth)
+{
+    return depth->mode == DEPTH_LOGARITHMIC ? SHADER_FEATURE_LOG_DEPTH : 0;
+}
+
+void DepthBufferProjection(const DepthBuffer *depth, float fovy, float aspect, mat4 out)
+{
+    if (depth->mode == DEPTH_LOGARITHMIC) {
+        // only x, y and w are used, the shaders replace z
+        glm_perspective(fovy, aspect, depth->near_plane, depth->far_plane, out);
+        return;
+    }
+    // infinite reversed-Z: clip z = near and w = -z_eye, so depth = near / distance
+    float f = 1.0f / tanf(fovy * 0.5f);
+    glm_mat4_zero(out);
+    out[0][0] = f / aspect;
+    out[1][1] = f;
+    out[2][3] = -1.0f;
+    out[3][2] = depth->near_plane;
+}
+
+float DepthBufferLogScale(const DepthBuffer *depth)
+{
+    return 2.0f / log2f(depth->far_plane + 1.0f);
+}
+
+void DepthBufferBegin(const DepthBuffer *depth)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, depth->framebuffer);
+    if (depth->mode == DEPTH_REVERSED_Z) {
+        glClearDepth(0.0);
+        glDepthFunc(GL_GREATER);
+    } else {
+        glClearDepth(1.0);
+        glDepthFunc(GL_LESS);
+    }
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void DepthBufferEnd(const DepthBuffer *depth)
+{
+    if (!depth->framebuffer)
+        return;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, depth->framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, depth->width, depth->height, 0, 0, depth->width, depth->height,
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cglm/cglm.h>
+#include "glad/glad.h"
+
+// One depth pass from a metre in front of the camera out past Neptune.
+// Preferred is reversed-Z: the scene renders into a framebuffer with a
+// 32-bit float depth attachment, glClipControl() maps clip z to [0, 1]
+// rather than [-1, 1], and an infinite projection puts the near plane at
+// depth 1 and infinity at 0. Floats are densest near 0, which reversing
+// spends on the far range, so relative precision stays about constant
+// with distance. The colour is blitted to the window afterwards.
+//
+// Without clip control (GL 4.5 or ARB_clip_control) the remap to [0, 1]
+// would lose the precision again, so the window is drawn to directly and
+// the vertex shaders built with SHADER_FEATURE_LOG_DEPTH write a
+// logarithmic depth instead.
+typedef enum {
+    DEPTH_REVERSED_Z,
+    DEPTH_LOGARITHMIC,
+} DepthMode;
+
+typedef struct {
+    DepthMode mode;
+    GLuint framebuffer;     // 0, the window, for DEPTH_LOGARITHMIC
+    GLuint color;
+    GLuint depth;
+    int width;
+    int height;
+    float near_plane;
+    float far_plane;        // only the logarithmic mapping has one
+} DepthBuffer;
+
+int DepthBufferInit(DepthBuffer *depth, int width, int height, float near_plane, float far_plane);
+void DepthBufferResize(DepthBuffer *depth, int width, int height);
+void DepthBufferDestroy(DepthBuffer *depth);
+
+// SHADER_VARIANT() feature bits every scene program must be built with
+unsigned int DepthBufferShaderFeatures(const DepthBuffer *depth);
+void DepthBufferProjection(const DepthBuffer *depth, float fovy, float aspect, mat4 out);
+// the logDepthScale uniform of the logarithmic variants
+float DepthBufferLogScale(const DepthBuffer *depth);
+
+// binds and clears the scene target, then End() puts it on the window
+void DepthBufferBegin(const DepthBuffer *depth);
+void DepthBufferEnd(const DepthBuffer *depth);
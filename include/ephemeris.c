@@ -0,0 +1,207 @@
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ephemeris.h"
+#include "arena.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define EPHEMERIS_CHUNK 256     // series evaluated together, the recurrence state stays on the stack
+
+
+uint64_t EphemerisHash(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+// Clenshaw's recurrence for n series whose coefficient k starts at
+// c + k * stride, at tau in [-1, 1]
+static void clenshaw(int n, int stride, int coefficient_count, const double *restrict c,
+                     double tau, double *restrict out)
+{
+    double b1[EPHEMERIS_CHUNK], b2[EPHEMERIS_CHUNK];
+    double two_tau = 2 * tau;
+    for (int s = 0; s < n; s++)
+        b1[s] = b2[s] = 0;
+    for (int k = coefficient_count - 1; k >= 1; k--) {
+        const double *restrict row = c + (size_t)k * stride;
+        for (int s = 0; s < n; s++) {
+            double b = row[s] + two_tau * b1[s] - b2[s];
+            b2[s] = b1[s];
+            b1[s] = b;
+        }
+    }
+    for (int s = 0; s < n; s++)
+        out[s] = c[s] + tau * b1[s] - b2[s];
+}
+
+static void evaluate_segment(const double *coefficients, int series, int coefficient_count,
+                             double tau, double *out)
+{
+    for (int s = 0; s < series; s += EPHEMERIS_CHUNK) {
+        int n = series - s < EPHEMERIS_CHUNK ? series - s : EPHEMERIS_CHUNK;
+        clenshaw(n, series, coefficient_count, coefficients + s, tau, out + s);
+    }
+}
+
+double EphemerisGenerate(const char *path, uint64_t key, int body_count, double start, double end,
+                         double segment_length, int coefficient_count, EphemerisSampler sample, void *user)
+{
+    if (coefficient_count < 1 || coefficient_count > EPHEMERIS_MAX_COEFFICIENTS || !(end > start)
+        || !(segment_length > 0) || body_count < 1) {
+        fprintf(stderr, "ephemeris: bad parameters for %s\n", path);
+        return -1;
+    }
+    int series = 3 * body_count;
+    int segment_count = (int)ceil((end - start) / segment_length);
+    int N = coefficient_count;
+
+    ArenaMarker mark = ArenaMark(&scratch_arena);
+    double *samples = ArenaAlloc(&scratch_arena, (size_t)N * series * sizeof(double));
+    double *coefficients = ArenaAlloc(&scratch_arena, (size_t)N * series * sizeof(double));
+    double *check = ArenaAlloc(&scratch_arena, 2 * (size_t)series * sizeof(double));
+    if (!samples || !coefficients || !check) {
+        perror("error allocating ephemeris");
+        ArenaRelease(&scratch_arena, mark);
+        return -1;
+    }
+
+    // the parent directory is ours to create, like the shader cache's
+    char tmp_path[256];
+    snprintf(tmp_path, sizeof(tmp_path), "%s", path);
+    char *slash = strrchr(tmp_path, '/');
+    if (slash) {
+        *slash = '\0';
+        mkdir(tmp_path, 0755);
+    }
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *file = fopen(tmp_path, "wb");
+    if (!file) {
+        perror(tmp_path);
+        ArenaRelease(&scratch_arena, mark);
+        return -1;
+    }
+    EphemerisHeader header = {
+        {'S', 'E', 'P', 'H'}, EPHEMERIS_VERSION, key, body_count, N, segment_count, 0, start, segment_length,
+    };
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    double max_error = 0;
+    for (int segment = 0; ok && segment < segment_count; segment++) {
+        double t0 = start + segment * segment_length;
+        // sample at the Chebyshev nodes, which keeps the fit close to minimax
+        for (int j = 0; j < N; j++) {
+            double x = cos(M_PI * (j + 0.5) / N);
+            sample(user, t0 + 0.5 * (x + 1) * segment_length, (double (*)[3])(samples + (size_t)j * series));
+        }
+        for (int k = 0; k < N; k++) {
+            double *row = coefficients + (size_t)k * series;
+            for (int s = 0; s < series; s++)
+                row[s] = 0;
+            for (int j = 0; j < N; j++) {
+                double weight = (k ? 2.0 : 1.0) / N * cos(M_PI * k * (j + 0.5) / N);
+                const double *node = samples + (size_t)j * series;
+                for (int s = 0; s < series; s++)
+                    row[s] += weight * node[s];
+            }
+        }
+        // the error peaks between the nodes and at the ends, check those
+        for (int j = 0; j <= N; j++) {
+            double x = cos(M_PI * j / N);
+            sample(user, t0 + 0.5 * (x + 1) * segment_length, (double (*)[3])check);
+            evaluate_segment(coefficients, series, N, x, check + series);
+            for (int s = 0; s < series; s++)
+                max_error = fmax(max_error, fabs(check[series + s] - check[s]));
+        }
+        ok = fwrite(coefficients, sizeof(double), (size_t)N * series, file) == (size_t)N * series;
+    }
+    ok = fclose(file) == 0 && ok;
+    ArenaRelease(&scratch_arena, mark);
+
+    // written aside and renamed over, so a reader never maps half a file
+    if (!ok || rename(tmp_path, path)) {
+        fprintf(stderr, "ephemeris: error writing %s\n", path);
+        remove(tmp_path);
+        return -1;
+    }
+    return max_error;
+}
+
+int EphemerisOpen(Ephemeris *ephemeris, const char *path, uint64_t key)
+{
+    *ephemeris = (Ephemeris) {0};
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return 1;
+    struct stat st;
+    if (fstat(fd, &st) || (size_t)st.st_size < sizeof(EphemerisHeader)) {
+        close(fd);
+        return 1;
+    }
+    void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror(path);
+        return 1;
+    }
+
+    const EphemerisHeader *header = mapping;
+    size_t expected = sizeof(EphemerisHeader) + (size_t)header->segment_count
+                    * header->coefficient_count * 3 * header->body_count * sizeof(double);
+    if (memcmp(header->magic, "SEPH", 4) != 0 || header->version != EPHEMERIS_VERSION
+        || header->key != key || header->coefficient_count < 1
+        || header->coefficient_count > EPHEMERIS_MAX_COEFFICIENTS || (size_t)st.st_size != expected) {
+        munmap(mapping, st.st_size);
+        return 1;
+    }
+    // small enough to fault in up front rather than on the first frames
+    madvise(mapping, st.st_size, MADV_WILLNEED);
+
+    ephemeris->mapping = mapping;
+    ephemeris->mapping_size = st.st_size;
+    ephemeris->coefficients = (const double *)(header + 1);
+    ephemeris->body_count = header->body_count;
+    ephemeris->coefficient_count = header->coefficient_count;
+    ephemeris->segment_count = header->segment_count;
+    ephemeris->start_time = header->start_time;
+    ephemeris->segment_length = header->segment_length;
+    ephemeris->end_time = header->start_time + header->segment_count * header->segment_length;
+    return 0;
+}
+
+void EphemerisClose(Ephemeris *ephemeris)
+{
+    if (ephemeris->mapping)
+        munmap(ephemeris->mapping, ephemeris->mapping_size);
+    *ephemeris = (Ephemeris) {0};
+}
+
+bool EphemerisCovers(const Ephemeris *ephemeris, double time)
+{
+    return ephemeris->mapping && time >= ephemeris->start_time && time < ephemeris->end_time;
+}
+
+void EphemerisEvaluate(const Ephemeris *ephemeris, double time, double (*positions)[3])
+{
+    int series = 3 * ephemeris->body_count;
+    double offset = (time - ephemeris->start_time) / ephemeris->segment_length;
+    int segment = (int)offset;
+    if (segment >= ephemeris->segment_count)
+        segment = ephemeris->segment_count - 1;
+    double tau = 2 * (offset - segment) - 1;
+    const double *coefficients = ephemeris->coefficients
+                               + (size_t)segment * ephemeris->coefficient_count * series;
+    evaluate_segment(coefficients, series, ephemeris->coefficient_count, tau, &positions[0][0]);
+}
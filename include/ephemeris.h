@@ -0,0 +1,60 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Body positions as piecewise Chebyshev series, fitted once from a source
+// of positions (the Kepler propagator, an integrator run or imported
+// data) and read back from a memory-mapped file. The time range is cut
+// into equal segments and every body is fitted on each one, so a frame
+// evaluates a single segment: a Clenshaw recurrence of a few FMAs per
+// coefficient for all series at once.
+//
+// File layout after the header: for each segment, coefficient k of every
+// series, then k + 1, ...; series go x, y, z per body. Keeping one
+// coefficient of all bodies together makes the recurrence a contiguous
+// loop across bodies.
+#define EPHEMERIS_VERSION 1
+#define EPHEMERIS_MAX_COEFFICIENTS 32
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;                  // identifies what the file was fitted from
+    uint32_t body_count;
+    uint32_t coefficient_count;    // per series, the degree plus one
+    uint32_t segment_count;
+    uint32_t reserved;
+    double start_time;
+    double segment_length;
+} EphemerisHeader;
+
+typedef struct {
+    void *mapping;
+    size_t mapping_size;
+    const double *coefficients;
+    int body_count;
+    int coefficient_count;
+    int segment_count;
+    double start_time;
+    double end_time;
+    double segment_length;
+} Ephemeris;
+
+// writes the position of every body at time into positions
+typedef void (*EphemerisSampler)(void *user, double time, double (*positions)[3]);
+
+uint64_t EphemerisHash(uint64_t hash, const void *data, size_t size);
+
+// fits [start, end) and writes the file; returns the largest position
+// error found between the fitting nodes, or a negative value on failure
+double EphemerisGenerate(const char *path, uint64_t key, int body_count, double start, double end,
+                         double segment_length, int coefficient_count, EphemerisSampler sample, void *user);
+
+// maps the file, 0 on success; a missing file or one with another key is an error
+int EphemerisOpen(Ephemeris *ephemeris, const char *path, uint64_t key);
+void EphemerisClose(Ephemeris *ephemeris);
+
+bool EphemerisCovers(const Ephemeris *ephemeris, double time);
+// positions of every body at a time the ephemeris covers
+void EphemerisEvaluate(const Ephemeris *ephemeris, double time, double (*positions)[3]);
@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "frame_stats.h"
+
+static unsigned int frame_activity;
+
+static const char *activity_names[FRAME_ACTIVITY_COUNT] = {
+    "texture upload",
+    "shader compile",
+    "mesh upload",
+};
+
+
+static int bucket_index(uint32_t us)
+{
+    if (us < 2 * FRAME_STATS_SUB_BUCKETS)
+        return us;
+
+    int exponent = (31 - __builtin_clz(us)) - FRAME_STATS_SUB_BUCKET_BITS;
+    if (exponent > FRAME_STATS_MAX_EXPONENT)
+        return FRAME_STATS_BUCKETS - 1;
+    return exponent * FRAME_STATS_SUB_BUCKETS + (us >> exponent);
+}
+
+// lowest value that lands in the bucket
+static uint32_t bucket_value(int index)
+{
+    if (index < 2 * FRAME_STATS_SUB_BUCKETS)
+        return index;
+
+    int exponent = index / FRAME_STATS_SUB_BUCKETS - 1;
+    uint32_t sub = index - exponent * FRAME_STATS_SUB_BUCKETS;
+    return sub << exponent;
+}
+
+
+void FrameStatsInit(FrameStats *stats, float stutter_factor, float summary_interval)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->stutter_factor = stutter_factor;
+    stats->summary_interval = summary_interval;
+    frame_activity = 0;
+}
+
+void FrameStatsNoteActivity(FrameActivity activity)
+{
+    frame_activity |= activity;
+}
+
+uint32_t FrameStatsPercentile(const FrameStats *stats, double percentile)
+{
+    if (stats->frames == 0)
+        return 0;
+
+    uint64_t target = (uint64_t)(percentile / 100.0 * stats->frames);
+    if (target >= stats->frames)
+        target = stats->frames - 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < FRAME_STATS_BUCKETS; i++) {
+        seen += stats->buckets[i];
+        if (seen > target)
+            return bucket_value(i);
+    }
+    return stats->max_us;
+}
+
+static void print_stutter(const FrameStats *stats, uint32_t us, unsigned int activity)
+{
+    printf("stutter: frame %llu took %.2f ms (%.1fx median %.2f ms)",
+           (unsigned long long)stats->frames, us / 1000.0,
+           (double)us / stats->median_us, stats->median_us / 1000.0);
+
+    if (!activity) {
+        printf(", no tracked activity\n");
+        return;
+    }
+    const char *separator = " during ";
+    for (int i = 0; i < FRAME_ACTIVITY_COUNT; i++) {
+        if (activity & (1u << i)) {
+            printf("%s%s", separator, activity_names[i]);
+            separator = ", ";
+        }
+    }
+    printf("\n");
+}
+
+void FrameStatsRecord(FrameStats *stats, double frame_time, double now)
+{
+    unsigned int activity = frame_activity;
+    frame_activity = 0;
+
+    if (frame_time <= 0.0)
+        return;
+
+    double us_f = frame_time * 1e6;
+    uint32_t us = us_f > UINT32_MAX ? UINT32_MAX : (uint32_t)us_f;
+
+    stats->buckets[bucket_index(us)]++;
+    stats->frames++;
+    stats->total_us += us;
+    if (us > stats->max_us)
+        stats->max_us = us;
+    if (us > stats->interval_max_us)
+        stats->interval_max_us = us;
+
+    if (stats->frames % FRAME_STATS_WARMUP_FRAMES == 0)
+        stats->median_us = FrameStatsPercentile(stats, 50.0);
+
+    if (stats->median_us > 0 && us > stats->stutter_factor * stats->median_us) {
+        stats->stutters++;
+        stats->interval_stutters++;
+        print_stutter(stats, us, activity);
+    }
+
+    if (stats->summary_interval > 0.0f && now - stats->last_summary >= stats->summary_interval) {
+        FrameStatsPrintSummary(stats);
+        stats->last_summary = now;
+    }
+}
+
+void FrameStatsPrintSummary(FrameStats *stats)
+{
+    if (stats->frames == 0)
+        return;
+
+    printf("frame time: %llu frames, mean %.2f ms, p50 %.2f, p90 %.2f, p99 %.2f, p99.9 %.2f, max %.2f ms\n",
+           (unsigned long long)stats->frames,
+           (double)stats->total_us / stats->frames / 1000.0,
+           FrameStatsPercentile(stats, 50.0) / 1000.0,
+           FrameStatsPercentile(stats, 90.0) / 1000.0,
+           FrameStatsPercentile(stats, 99.0) / 1000.0,
+           FrameStatsPercentile(stats, 99.9) / 1000.0,
+           stats->max_us / 1000.0);
+    printf("            %llu stutters total, %llu since last summary (worst %.2f ms)\n",
+           (unsigned long long)stats->stutters,
+           (unsigned long long)stats->interval_stutters,
+           stats->interval_max_us / 1000.0);
+
+    stats->interval_stutters = 0;
+    stats->interval_max_us = 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <stdint.h>
+
+// Frame times are kept in microseconds in an HDR-style histogram: values below
+// 2 * FRAME_STATS_SUB_BUCKETS are counted exactly, above that every power of two
+// is split into FRAME_STATS_SUB_BUCKETS linear buckets, so the relative error
+// stays under 1 / FRAME_STATS_SUB_BUCKETS whatever the magnitude.
+#define FRAME_STATS_SUB_BUCKET_BITS 5
+#define FRAME_STATS_SUB_BUCKETS (1 << FRAME_STATS_SUB_BUCKET_BITS)
+#define FRAME_STATS_MAX_EXPONENT 20 // top bucket starts at ~67 seconds
+#define FRAME_STATS_BUCKETS ((FRAME_STATS_MAX_EXPONENT + 2) * FRAME_STATS_SUB_BUCKETS)
+
+// frames recorded before the stutter detector trusts the median
+#define FRAME_STATS_WARMUP_FRAMES 120
+
+// things that can happen inside a frame and explain a hitch
+typedef enum {
+    FRAME_ACTIVITY_TEXTURE_UPLOAD = 1 << 0,
+    FRAME_ACTIVITY_SHADER_COMPILE = 1 << 1,
+    FRAME_ACTIVITY_MESH_UPLOAD    = 1 << 2,
+    FRAME_ACTIVITY_COUNT          = 3
+} FrameActivity;
+
+typedef struct {
+    uint32_t buckets[FRAME_STATS_BUCKETS];
+    uint64_t frames;
+    uint64_t total_us;
+    uint32_t max_us;
+
+    float stutter_factor;     // a frame is a stutter above stutter_factor * median
+    uint32_t median_us;       // refreshed every FRAME_STATS_WARMUP_FRAMES frames
+    uint64_t stutters;
+
+    float summary_interval;   // seconds between summaries, 0 disables them
+    double last_summary;
+    uint64_t interval_stutters;
+    uint32_t interval_max_us;
+} FrameStats;
+
+void FrameStatsInit(FrameStats *stats, float stutter_factor, float summary_interval);
+void FrameStatsRecord(FrameStats *stats, double frame_time, double now);
+uint32_t FrameStatsPercentile(const FrameStats *stats, double percentile);
+void FrameStatsPrintSummary(FrameStats *stats);
+
+// marks an activity as having happened during the frame currently being timed
+void FrameStatsNoteActivity(FrameActivity activity);
@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "gl_caps.h"
+
+GLCaps gl_caps;
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glad_glMaxShaderCompilerThreadsKHR;
+
+
+bool GLCapsHasExtension(const char *name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+        if (extension && strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+void GLCapsInit(GLADloadproc load)
+{
+    gl_caps.major = GLVersion.major;
+    gl_caps.minor = GLVersion.minor;
+
+    if (!glad_glMultiDrawElementsIndirect && GLCapsHasExtension("GL_ARB_multi_draw_indirect")
+        && GLCapsHasExtension("GL_ARB_draw_indirect"))
+        glad_glMultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)load("glMultiDrawElementsIndirect");
+    gl_caps.multi_draw_indirect = glad_glMultiDrawElementsIndirect != NULL;
+
+    if (!glad_glDrawElementsInstancedBaseVertexBaseInstance && GLCapsHasExtension("GL_ARB_base_instance"))
+        glad_glDrawElementsInstancedBaseVertexBaseInstance = (PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC)
+            load("glDrawElementsInstancedBaseVertexBaseInstance");
+    gl_caps.base_instance = glad_glDrawElementsInstancedBaseVertexBaseInstance != NULL;
+
+    if (!glad_glGetProgramBinary && GLCapsHasExtension("GL_ARB_get_program_binary")) {
+        glad_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+        glad_glProgramBinary = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+        glad_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+    }
+    // drivers may expose the entry points but no format to save in
+    GLint binary_formats = 0;
+    if (glad_glGetProgramBinary && glad_glProgramBinary && glad_glProgramParameteri)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binary_formats);
+    gl_caps.program_binary = binary_formats > 0;
+
+    if (GLCapsHasExtension("GL_KHR_parallel_shader_compile"))
+        glad_glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)
+            load("glMaxShaderCompilerThreadsKHR");
+    gl_caps.parallel_shader_compile = glad_glMaxShaderCompilerThreadsKHR != NULL;
+    // 0xFFFFFFFF lets the driver pick how many threads to use
+    if (gl_caps.parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+
+    if (!glad_glClipControl && GLCapsHasExtension("GL_ARB_clip_control"))
+        glad_glClipControl = (PFNGLCLIPCONTROLPROC)load("glClipControl");
+    gl_caps.clip_control = glad_glClipControl != NULL;
+
+    printf("OpenGL %d.%d: multi-draw indirect %s, base instance %s, program binaries %s, "
+           "parallel shader compile %s, clip control %s\n",
+           gl_caps.major, gl_caps.minor,
+           gl_caps.multi_draw_indirect ? "yes" : "no",
+           gl_caps.base_instance ? "yes" : "no",
+           gl_caps.program_binary ? "yes" : "no",
+           gl_caps.parallel_shader_compile ? "yes" : "no",
+           gl_caps.clip_control ? "yes" : "no");
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <stdbool.h>
+#include "glad/glad.h"
+
+// What the current context can do beyond the GL 3.3 baseline. Entry points
+// of extensions that glad did not load (it only loads core versions) are
+// fetched here, so callers only test the flag and then call through glad.
+
+// KHR_parallel_shader_compile is not in the generated loader at all
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+extern PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glad_glMaxShaderCompilerThreadsKHR;
+#define glMaxShaderCompilerThreadsKHR glad_glMaxShaderCompilerThreadsKHR
+
+typedef struct {
+    int major;
+    int minor;
+    bool multi_draw_indirect;       // GL 4.3 or ARB_multi_draw_indirect
+    bool base_instance;             // GL 4.2 or ARB_base_instance
+    bool program_binary;            // GL 4.1 or ARB_get_program_binary, with at least one format
+    bool parallel_shader_compile;   // KHR_parallel_shader_compile, GL_COMPLETION_STATUS_KHR can be polled
+    bool clip_control;              // GL 4.5 or ARB_clip_control
+} GLCaps;
+
+extern GLCaps gl_caps;
+
+void GLCapsInit(GLADloadproc load);
+bool GLCapsHasExtension(const char *name);
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "gl_state.h"
+
+// texture targets tracked per unit, anything else is passed straight through
+enum { TARGET_2D, TARGET_2D_ARRAY, TARGET_CUBE_MAP, TARGET_COUNT };
+
+// the cache starts unknown, so the first bind of every point is always issued
+#define UNKNOWN 0xFFFFFFFFu
+
+static GLuint current_program = UNKNOWN;
+static GLuint current_vao = UNKNOWN;
+static GLenum current_unit = UNKNOWN;
+static GLuint current_textures[GL_STATE_TEXTURE_UNITS][TARGET_COUNT];
+static int textures_known;
+
+static GLStateCounters counters;
+static GLStateCounters last_frame;
+
+
+static int target_index(GLenum target)
+{
+    switch (target) {
+        case GL_TEXTURE_2D:       return TARGET_2D;
+        case GL_TEXTURE_2D_ARRAY: return TARGET_2D_ARRAY;
+        case GL_TEXTURE_CUBE_MAP: return TARGET_CUBE_MAP;
+        default:                  return -1;
+    }
+}
+
+void GLStateInvalidate(void)
+{
+    current_program = UNKNOWN;
+    current_vao = UNKNOWN;
+    current_unit = UNKNOWN;
+    textures_known = 0;
+}
+
+void GLStateUseProgram(GLuint program)
+{
+    if (program == current_program) {
+        counters.program.skipped++;
+        return;
+    }
+    glUseProgram(program);
+    current_program = program;
+    counters.program.issued++;
+}
+
+void GLStateBindVertexArray(GLuint vao)
+{
+    if (vao == current_vao) {
+        counters.vertex_array.skipped++;
+        return;
+    }
+    glBindVertexArray(vao);
+    current_vao = vao;
+    counters.vertex_array.issued++;
+}
+
+void GLStateActiveTexture(GLenum unit)
+{
+    if (unit == current_unit) {
+        counters.active_texture.skipped++;
+        return;
+    }
+    glActiveTexture(unit);
+    current_unit = unit;
+    counters.active_texture.issued++;
+}
+
+void GLStateBindTexture(GLenum target, GLuint texture)
+{
+    int index = target_index(target);
+    int unit = current_unit == UNKNOWN ? -1 : (int)(current_unit - GL_TEXTURE0);
+
+    if (index < 0 || unit < 0 || unit >= GL_STATE_TEXTURE_UNITS) {
+        glBindTexture(target, texture);
+        counters.texture.issued++;
+        return;
+    }
+    if (!textures_known) {
+        memset(current_textures, 0xFF, sizeof(current_textures));
+        textures_known = 1;
+    }
+    if (current_textures[unit][index] == texture) {
+        counters.texture.skipped++;
+        return;
+    }
+    glBindTexture(target, texture);
+    current_textures[unit][index] = texture;
+    counters.texture.issued++;
+}
+
+void GLStateEndFrame(void)
+{
+    last_frame = counters;
+    memset(&counters, 0, sizeof(counters));
+}
+
+const GLStateCounters *GLStateLastFrame(void)
+{
+    return &last_frame;
+}
+
+void GLStatePrintCounters(const GLStateCounters *c)
+{
+    printf("state changes (issued/skipped): program %u/%u, vao %u/%u, active texture %u/%u, texture %u/%u\n",
+           c->program.issued, c->program.skipped,
+           c->vertex_array.issued, c->vertex_array.skipped,
+           c->active_texture.issued, c->active_texture.skipped,
+           c->texture.issued, c->texture.skipped);
+}
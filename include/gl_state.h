@@ -0,0 +1,30 @@
+#pragma once
+#include "glad/glad.h"
+
+// Thin cache over the GL binding points the renderer touches every frame.
+// Every bind of these points must go through here, otherwise the cache goes
+// stale; call GLStateInvalidate() after code that binds behind its back.
+#define GL_STATE_TEXTURE_UNITS 16
+
+typedef struct {
+    unsigned int issued;
+    unsigned int skipped;
+} GLStateCounter;
+
+typedef struct {
+    GLStateCounter program;
+    GLStateCounter vertex_array;
+    GLStateCounter active_texture;
+    GLStateCounter texture;
+} GLStateCounters;
+
+void GLStateUseProgram(GLuint program);
+void GLStateBindVertexArray(GLuint vao);
+void GLStateActiveTexture(GLenum unit);
+void GLStateBindTexture(GLenum target, GLuint texture);
+void GLStateInvalidate(void);
+
+// moves the running counters into the last-frame snapshot and clears them
+void GLStateEndFrame(void);
+const GLStateCounters *GLStateLastFrame(void);
+void GLStatePrintCounters(const GLStateCounters *counters);
@@ -0,0 +1,300 @@
+#include <math.h>
+#include <stdio.h>
+
+#include "kepler.h"
+#include "mem_track.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define KEPLER_COLUMNS 17
+
+
+// every per-body array, in one place so growing and freeing cannot miss one
+static void columns(KeplerOrbits *orbits, double **out[KEPLER_COLUMNS])
+{
+    double **all[KEPLER_COLUMNS] = {
+        &orbits->semi_major_axis, &orbits->eccentricity, &orbits->inclination,
+        &orbits->ascending_node, &orbits->argument_periapsis, &orbits->mean_anomaly,
+        &orbits->mean_motion,
+        &orbits->px, &orbits->py, &orbits->pz, &orbits->qx, &orbits->qy, &orbits->qz,
+        &orbits->eccentric_anomaly, &orbits->x, &orbits->y, &orbits->z,
+    };
+    for (int c = 0; c < KEPLER_COLUMNS; c++)
+        out[c] = all[c];
+}
+
+static int reserve(KeplerOrbits *orbits, int capacity)
+{
+    if (capacity <= orbits->capacity)
+        return 0;
+    double **column[KEPLER_COLUMNS];
+    columns(orbits, column);
+    for (int c = 0; c < KEPLER_COLUMNS; c++) {
+        double *grown = MemTrackRealloc(MEM_SIMULATION, *column[c], capacity * sizeof(double));
+        if (!grown) {
+            perror("error allocating orbits");
+            return 1;
+        }
+        *column[c] = grown;
+    }
+    orbits->capacity = capacity;
+    return 0;
+}
+
+int KeplerOrbitsInit(KeplerOrbits *orbits, int capacity)
+{
+    *orbits = (KeplerOrbits) {0};
+    return reserve(orbits, capacity > 0 ? capacity : 16);
+}
+
+void KeplerOrbitsFree(KeplerOrbits *orbits)
+{
+    double **column[KEPLER_COLUMNS];
+    columns(orbits, column);
+    for (int c = 0; c < KEPLER_COLUMNS; c++) {
+        MemTrackFree(MEM_SIMULATION, *column[c]);
+        *column[c] = NULL;
+    }
+    orbits->count = orbits->capacity = 0;
+}
+
+int KeplerOrbitsAdd(KeplerOrbits *orbits, const OrbitalElements *elements)
+{
+    if (orbits->count == orbits->capacity && reserve(orbits, orbits->capacity * 2))
+        return -1;
+    if (KeplerOrbitsSet(orbits, orbits->count, elements))
+        return -1;
+    return orbits->count++;
+}
+
+int KeplerOrbitsSet(KeplerOrbits *orbits, int k, const OrbitalElements *elements)
+{
+    double a = elements->semi_major_axis;
+    double e = elements->eccentricity;
+    if (!(a > 0) || !(e >= 0) || e > KEPLER_MAX_ECCENTRICITY) {
+        fprintf(stderr, "orbit with a = %g, e = %g is not a bound ellipse, skipped\n", a, e);
+        return 1;
+    }
+    orbits->semi_major_axis[k] = a;
+    orbits->eccentricity[k] = e;
+    orbits->inclination[k] = elements->inclination;
+    orbits->ascending_node[k] = elements->ascending_node;
+    orbits->argument_periapsis[k] = elements->argument_periapsis;
+    orbits->mean_anomaly[k] = elements->mean_anomaly;
+    orbits->mean_motion[k] = elements->mean_motion;
+
+    // perifocal axes rotated by node, inclination and periapsis, in ecliptic
+    // coordinates (z to the north pole) ...
+    double cos_node = cos(elements->ascending_node), sin_node = sin(elements->ascending_node);
+    double cos_peri = cos(elements->argument_periapsis), sin_peri = sin(elements->argument_periapsis);
+    double cos_inc = cos(elements->inclination), sin_inc = sin(elements->inclination);
+    double p[3] = {
+        cos_peri * cos_node - sin_peri * sin_node * cos_inc,
+        cos_peri * sin_node + sin_peri * cos_node * cos_inc,
+        sin_peri * sin_inc,
+    };
+    double q[3] = {
+        -sin_peri * cos_node - cos_peri * sin_node * cos_inc,
+        -sin_peri * sin_node + cos_peri * cos_node * cos_inc,
+        cos_peri * sin_inc,
+    };
+    // ... then into world axes, ecliptic (x, y, z) -> (x, z, -y)
+    double b = a * sqrt(1 - e * e);
+    orbits->px[k] = a * p[0];
+    orbits->py[k] = a * p[2];
+    orbits->pz[k] = -a * p[1];
+    orbits->qx[k] = b * q[0];
+    orbits->qy[k] = b * q[2];
+    orbits->qz[k] = -b * q[1];
+
+    orbits->eccentric_anomaly[k] = 0;
+    orbits->x[k] = orbits->y[k] = orbits->z[k] = 0;
+    return 0;
+}
+
+double KeplerMeanMotion(double semi_major_axis, double mu)
+{
+    return sqrt(mu / (semi_major_axis * semi_major_axis * semi_major_axis));
+}
+
+// sin and cos together, branch-free so loops calling it vectorise without
+// a vector math library: reduce to |r| <= pi/4 around the nearest multiple
+// of pi/2, then the Cephes minimax polynomials (about 1 ulp on that range).
+// Only meant for the few periods either side of zero the solver works in.
+static inline void sin_cos(double x, double *s, double *c)
+{
+    int q = (int)(x * (2 / M_PI) + (x >= 0 ? 0.5 : -0.5));
+    double r = ((x - q * 1.57079625129699707031) - q * 7.54978941586159635335e-8)
+             - q * 5.39030285815811905290e-15;
+    double r2 = r * r;
+    double sin_r = r + r * r2 * (-1.66666666666666307295e-1 + r2 * (8.33333333332211858878e-3
+                 + r2 * (-1.98412698295895385996e-4 + r2 * (2.75573136213857245213e-6
+                 + r2 * (-2.50507477628578072866e-8 + r2 * 1.58962301576546568060e-10)))));
+    double cos_r = 1 - 0.5 * r2 + r2 * r2 * (4.16666666666665929218e-2 + r2 * (-1.38888888888730564116e-3
+                 + r2 * (2.48015872888517045348e-5 + r2 * (-2.75573141792967388112e-7
+                 + r2 * (2.08757008419747316778e-9 + r2 * -1.13585365213876817300e-11)))));
+    double sin_x = q & 1 ? cos_r : sin_r;
+    double cos_x = q & 1 ? sin_r : cos_r;
+    *s = q & 2 ? -sin_x : sin_x;
+    *c = (q + 1) & 2 ? -cos_x : cos_x;
+}
+
+// Danby's starting guess, E0 = M + 0.85 e sign(M)
+static inline double starting_guess(double M, double e)
+{
+    return M + copysign(0.85 * e, M);
+}
+
+// one Halley step on f(E) = E - e sin E - M, with f' = 1 - e cos E and f'' = e sin E
+static inline double halley_step(double E, double M, double e)
+{
+    double s, c;
+    sin_cos(E, &s, &c);
+    s *= e;
+    c *= e;
+    double f = E - s - M;
+    double df = 1 - c;
+    return E - f / (df - 0.5 * f * s / df);
+}
+
+double KeplerSolve(double mean_anomaly, double eccentricity)
+{
+    double E = starting_guess(mean_anomaly, eccentricity);
+    for (int it = 0; it < KEPLER_ITERATIONS; it++)
+        E = halley_step(E, mean_anomaly, eccentricity);
+    return E;
+}
+
+// restrict is only honoured on parameters, so each pass over a block is a
+// function of its own
+
+static void wrap_mean_anomaly(int n, double time, const double *restrict mean_anomaly,
+                              const double *restrict mean_motion, double *restrict M)
+{
+    // the product grows without bound, wrapped to [-pi, pi] the solver
+    // starts from the same guesses at any time
+    const double two_pi = 2 * M_PI;
+    for (int k = 0; k < n; k++) {
+        double m = mean_anomaly[k] + mean_motion[k] * time;
+        M[k] = m - two_pi * floor(m / two_pi + 0.5);
+    }
+}
+
+static void solve_block(int n, const double *restrict M, const double *restrict e, double *restrict E)
+{
+    // one pass over the block per step, rather than iterating each body in turn
+    for (int k = 0; k < n; k++)
+        E[k] = starting_guess(M[k], e[k]);
+    for (int it = 0; it < KEPLER_ITERATIONS; it++) {
+        for (int k = 0; k < n; k++)
+            E[k] = halley_step(E[k], M[k], e[k]);
+    }
+}
+
+static void place_block(int n, const double *restrict E, const double *restrict e,
+                        const double *restrict px, const double *restrict py, const double *restrict pz,
+                        const double *restrict qx, const double *restrict qy, const double *restrict qz,
+                        double *restrict x, double *restrict y, double *restrict z)
+{
+    for (int k = 0; k < n; k++) {
+        double v, u;
+        sin_cos(E[k], &v, &u);
+        u -= e[k];
+        x[k] = px[k] * u + qx[k] * v;
+        y[k] = py[k] * u + qy[k] * v;
+        z[k] = pz[k] * u + qz[k] * v;
+    }
+}
+
+void KeplerOrbitsPropagate(KeplerOrbits *orbits, double time)
+{
+    double M[KEPLER_BLOCK];
+    for (int s = 0; s < orbits->count; s += KEPLER_BLOCK) {
+        int n = orbits->count - s < KEPLER_BLOCK ? orbits->count - s : KEPLER_BLOCK;
+        wrap_mean_anomaly(n, time, orbits->mean_anomaly + s, orbits->mean_motion + s, M);
+        solve_block(n, M, orbits->eccentricity + s, orbits->eccentric_anomaly + s);
+        place_block(n, orbits->eccentric_anomaly + s, orbits->eccentricity + s,
+                    orbits->px + s, orbits->py + s, orbits->pz + s,
+                    orbits->qx + s, orbits->qy + s, orbits->qz + s,
+                    orbits->x + s, orbits->y + s, orbits->z + s);
+    }
+}
+
+void KeplerOrbitPoint(const KeplerOrbits *orbits, int body, double eccentric_anomaly, double out[3])
+{
+    double u = cos(eccentric_anomaly) - orbits->eccentricity[body];
+    double v = sin(eccentric_anomaly);
+    out[0] = orbits->px[body] * u + orbits->qx[body] * v;
+    out[1] = orbits->py[body] * u + orbits->qy[body] * v;
+    out[2] = orbits->pz[body] * u + orbits->qz[body] * v;
+}
+
+void KeplerOrbitVelocity(const KeplerOrbits *orbits, int body, double eccentric_anomaly, double out[3])
+{
+    // d/dt of the point above, with dE/dt = n / (1 - e cos E)
+    double c = cos(eccentric_anomaly), s = sin(eccentric_anomaly);
+    double rate = orbits->mean_motion[body] / (1 - orbits->eccentricity[body] * c);
+    out[0] = rate * (orbits->qx[body] * c - orbits->px[body] * s);
+    out[1] = rate * (orbits->qy[body] * c - orbits->py[body] * s);
+    out[2] = rate * (orbits->qz[body] * c - orbits->pz[body] * s);
+}
+
+static double dot(const double a[3], const double b[3])
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void cross(const double a[3], const double b[3], double out[3])
+{
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+int KeplerElementsFromState(const double position[3], const double velocity[3], double mu, double time,
+                            OrbitalElements *out)
+{
+    // back to ecliptic axes, world (x, y, z) -> (x, -z, y)
+    double r[3] = {position[0], -position[2], position[1]};
+    double v[3] = {velocity[0], -velocity[2], velocity[1]};
+    double r_length = sqrt(dot(r, r));
+    double v2 = dot(v, v);
+    double a = 1 / (2 / r_length - v2 / mu);
+
+    double h[3], e_vector[3];
+    cross(r, v, h);
+    double h_length = sqrt(dot(h, h));
+    double rv = dot(r, v);
+    for (int i = 0; i < 3; i++)
+        e_vector[i] = ((v2 - mu / r_length) * r[i] - rv * v[i]) / mu;
+    double e = sqrt(dot(e_vector, e_vector));
+    if (!(a > 0) || !(h_length > 0) || e > KEPLER_MAX_ECCENTRICITY)
+        return 1;
+
+    // the node is undefined in the reference plane and the periapsis on a
+    // circle, both are then measured from the x axis instead
+    double w[3] = {h[0] / h_length, h[1] / h_length, h[2] / h_length};
+    double node_length = sqrt(h[0] * h[0] + h[1] * h[1]);
+    double node = node_length > 1e-12 * h_length ? atan2(h[0], -h[1]) : 0;
+    double n[3] = {cos(node), sin(node), 0};
+    double n_ahead[3], p[3], p_ahead[3];
+    cross(w, n, n_ahead);
+    for (int i = 0; i < 3; i++)
+        p[i] = e > 1e-12 ? e_vector[i] / e : n[i];
+    cross(w, p, p_ahead);
+    double true_anomaly = atan2(dot(r, p_ahead), dot(r, p));
+    double E = atan2(sqrt(1 - e * e) * sin(true_anomaly), e + cos(true_anomaly));
+
+    double mean_motion = KeplerMeanMotion(a, mu);
+    double M = E - e * sin(E) - mean_motion * time;
+    *out = (OrbitalElements) {
+        .semi_major_axis = a, .eccentricity = e,
+        .inclination = atan2(node_length, h[2]), .ascending_node = node,
+        .argument_periapsis = atan2(dot(p, n_ahead), dot(p, n)),
+        .mean_anomaly = M - 2 * M_PI * floor(M / (2 * M_PI) + 0.5),
+        .mean_motion = mean_motion,
+    };
+    return 0;
+}
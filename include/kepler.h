@@ -0,0 +1,73 @@
+#pragma once
+
+// Bodies on fixed Keplerian ellipses around one centre, stored one array
+// per field so a propagation step runs the same branch-free loop over
+// every body. The Kepler equation M = E - e sin E is solved with a fixed
+// number of Halley steps from Danby's starting guess, which reach double
+// precision up to e = 0.99 without a per-body convergence test, so the loop
+// carries no divergent control flow and vectorises across bodies. State is
+// double so orbits keep sub-kilometre precision at solar-system distances.
+//
+// Positions are in world axes: the reference plane (the ecliptic) is xz,
+// its north pole +y, and angles are in radians.
+#define KEPLER_ITERATIONS 5
+#define KEPLER_BLOCK 256       // bodies solved per pass, the temporaries stay in L1
+#define KEPLER_MAX_ECCENTRICITY 0.99
+
+typedef struct {
+    double semi_major_axis;    // a, world units
+    double eccentricity;       // e
+    double inclination;        // i
+    double ascending_node;     // longitude of the ascending node
+    double argument_periapsis; // argument of periapsis
+    double mean_anomaly;       // mean anomaly at time 0
+    double mean_motion;        // radians per second of simulation time
+} OrbitalElements;
+
+typedef struct {
+    int count;
+    int capacity;
+
+    // elements, as given
+    double *semi_major_axis;
+    double *eccentricity;
+    double *inclination;
+    double *ascending_node;
+    double *argument_periapsis;
+    double *mean_anomaly;
+    double *mean_motion;
+
+    // orbit-plane axes towards periapsis (p) and 90 degrees ahead (q),
+    // scaled by a and by b = a sqrt(1 - e^2), derived when a body is added
+    double *px, *py, *pz;
+    double *qx, *qy, *qz;
+
+    // written by KeplerOrbitsPropagate()
+    double *eccentric_anomaly;
+    double *x, *y, *z;
+} KeplerOrbits;
+
+int KeplerOrbitsInit(KeplerOrbits *orbits, int capacity);
+void KeplerOrbitsFree(KeplerOrbits *orbits);
+// returns the body's index, or -1 for an unbound orbit or allocation failure
+int KeplerOrbitsAdd(KeplerOrbits *orbits, const OrbitalElements *elements);
+// replaces the elements of an existing body, 0 on success
+int KeplerOrbitsSet(KeplerOrbits *orbits, int body, const OrbitalElements *elements);
+
+// mean motion of an orbit of semi-major axis a around a body with
+// gravitational parameter mu, in the units of both
+double KeplerMeanMotion(double semi_major_axis, double mu);
+// eccentric anomaly for mean anomaly M in [-pi, pi]
+double KeplerSolve(double mean_anomaly, double eccentricity);
+
+// positions of every body at the given simulation time
+void KeplerOrbitsPropagate(KeplerOrbits *orbits, double time);
+// point on the body's ellipse at eccentric anomaly E, for drawing orbits
+void KeplerOrbitPoint(const KeplerOrbits *orbits, int body, double eccentric_anomaly, double out[3]);
+// velocity at eccentric anomaly E, in world units per second
+void KeplerOrbitVelocity(const KeplerOrbits *orbits, int body, double eccentric_anomaly, double out[3]);
+// osculating elements of a world-axis position and velocity about a centre
+// of gravitational parameter mu, with the mean anomaly referred back to
+// time 0; 0 on success, nonzero if the orbit is not a bound ellipse
+int KeplerElementsFromState(const double position[3], const double velocity[3], double mu, double time,
+                            OrbitalElements *out);
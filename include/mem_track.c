@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mem_track.h"
+
+// GL names are only unique per object type
+typedef enum {
+    OBJECT_BUFFER,
+    OBJECT_TEXTURE,
+    OBJECT_RENDERBUFFER,
+} ObjectType;
+
+typedef struct {
+    GLuint name;
+    unsigned char type;
+    unsigned char subsystem;
+    size_t bytes;
+} TrackedObject;
+
+// size header in front of every tracked CPU block, padded to keep alignment
+typedef union {
+    size_t size;
+    max_align_t align;
+} BlockHeader;
+
+static MemUsage usage[MEM_SUBSYSTEM_COUNT][MEM_KIND_COUNT];
+static TrackedObject objects[MEM_TRACK_GL_OBJECTS];
+static int object_count;
+
+static const char *subsystem_names[MEM_SUBSYSTEM_COUNT] = {
+    "textures",
+    "meshes",
+    "orbits",
+    "simulation",
+    "renderer",
+    "transient",
+};
+static const char *kind_names[MEM_KIND_COUNT] = {"CPU", "GPU"};
+
+
+void MemTrackSetBudget(MemSubsystem subsystem, MemKind kind, size_t bytes)
+{
+    usage[subsystem][kind].budget = bytes;
+}
+
+const MemUsage *MemTrackUsage(MemSubsystem subsystem, MemKind kind)
+{
+    return &usage[subsystem][kind];
+}
+
+static void book(MemSubsystem subsystem, MemKind kind, size_t added, size_t removed)
+{
+    MemUsage *u = &usage[subsystem][kind];
+    u->current = u->current + added - removed;
+    if (u->current > u->peak)
+        u->peak = u->current;
+
+    if (u->budget && u->current > u->budget && !u->over_budget) {
+        u->over_budget = 1;
+        fprintf(stderr, "memory budget: %s %s at %.1f MiB, budget %.1f MiB\n",
+                subsystem_names[subsystem], kind_names[kind],
+                u->current / (1024.0 * 1024.0), u->budget / (1024.0 * 1024.0));
+    } else if (u->over_budget && u->current <= u->budget) {
+        u->over_budget = 0;
+    }
+}
+
+void *MemTrackAlloc(MemSubsystem subsystem, size_t size)
+{
+    BlockHeader *header = malloc(sizeof(BlockHeader) + size);
+    if (!header)
+        return NULL;
+    header->size = size;
+    usage[subsystem][MEM_CPU].live++;
+    book(subsystem, MEM_CPU, size, 0);
+    return header + 1;
+}
+
+void *MemTrackRealloc(MemSubsystem subsystem, void *ptr, size_t size)
+{
+    if (!ptr)
+        return MemTrackAlloc(subsystem, size);
+
+    BlockHeader *header = (BlockHeader *)ptr - 1;
+    size_t old_size = header->size;
+    BlockHeader *grown = realloc(header, sizeof(BlockHeader) + size);
+    if (!grown)
+        return NULL;
+    grown->size = size;
+    book(subsystem, MEM_CPU, size, old_size);
+    return grown + 1;
+}
+
+void MemTrackFree(MemSubsystem subsystem, void *ptr)
+{
+    if (!ptr)
+        return;
+    BlockHeader *header = (BlockHeader *)ptr - 1;
+    usage[subsystem][MEM_CPU].live--;
+    book(subsystem, MEM_CPU, 0, header->size);
+    free(header);
+}
+
+static TrackedObject *find_object(GLuint name, ObjectType type)
+{
+    for (int i = 0; i < object_count; i++) {
+        if (objects[i].name == name && objects[i].type == type)
+            return &objects[i];
+    }
+    return NULL;
+}
+
+static void track_object(MemSubsystem subsystem, GLuint name, ObjectType type, size_t bytes)
+{
+    TrackedObject *object = find_object(name, type);
+    if (object) {
+        book(object->subsystem, MEM_GPU, 0, object->bytes);
+        usage[object->subsystem][MEM_GPU].live--;
+    } else if (object_count < MEM_TRACK_GL_OBJECTS) {
+        object = &objects[object_count++];
+    } else {
+        fprintf(stderr, "memory tracker: too many GL objects, %u not tracked\n", name);
+        return;
+    }
+
+    *object = (TrackedObject) {name, type, subsystem, bytes};
+    usage[subsystem][MEM_GPU].live++;
+    book(subsystem, MEM_GPU, bytes, 0);
+}
+
+static void forget_object(GLuint name, ObjectType type)
+{
+    TrackedObject *object = find_object(name, type);
+    if (!object)
+        return;
+    usage[object->subsystem][MEM_GPU].live--;
+    book(object->subsystem, MEM_GPU, 0, object->bytes);
+    *object = objects[--object_count];
+}
+
+void MemTrackBufferData(MemSubsystem subsystem, GLenum target, GLuint buffer,
+                        GLsizeiptr size, const void *data, GLenum usage_hint)
+{
+    glBufferData(target, size, data, usage_hint);
+    track_object(subsystem, buffer, OBJECT_BUFFER, size);
+}
+
+void MemTrackTexture(MemSubsystem subsystem, GLuint texture, size_t bytes)
+{
+    track_object(subsystem, texture, OBJECT_TEXTURE, bytes);
+}
+
+size_t MemTrackTextureSize(int width, int height, int layers, int bytes_per_texel, int mipmapped)
+{
+    size_t bytes = 0;
+    do {
+        bytes += (size_t)width * height * layers * bytes_per_texel;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    } while (mipmapped && (width > 1 || height > 1));
+    if (mipmapped)
+        bytes += (size_t)layers * bytes_per_texel;   // the 1x1 level
+    return bytes;
+}
+
+void MemTrackRenderbufferStorage(MemSubsystem subsystem, GLuint renderbuffer, GLenum format,
+                                 int width, int height, int bytes_per_pixel)
+{
+    glRenderbufferStorage(GL_RENDERBUFFER, format, width, height);
+    track_object(subsystem, renderbuffer, OBJECT_RENDERBUFFER, (size_t)width * height * bytes_per_pixel);
+}
+
+void MemTrackForgetBuffer(GLuint buffer)
+{
+    forget_object(buffer, OBJECT_BUFFER);
+}
+
+void MemTrackForgetTexture(GLuint texture)
+{
+    forget_object(texture, OBJECT_TEXTURE);
+}
+
+void MemTrackForgetRenderbuffer(GLuint renderbuffer)
+{
+    forget_object(renderbuffer, OBJECT_RENDERBUFFER);
+}
+
+void MemTrackPrintReport(void)
+{
+    const double mib = 1024.0 * 1024.0;
+    printf("%-12s %-30s %s\n", "memory:", "CPU MiB (peak / budget)", "GPU MiB (peak / budget)");
+    MemUsage total[MEM_KIND_COUNT] = {0};
+    for (int s = 0; s < MEM_SUBSYSTEM_COUNT; s++) {
+        printf("  %-10s", subsystem_names[s]);
+        for (int k = 0; k < MEM_KIND_COUNT; k++) {
+            const MemUsage *u = &usage[s][k];
+            char budget[16] = "-";
+            if (u->budget)
+                snprintf(budget, sizeof(budget), "%.1f", u->budget / mib);
+            printf(" %8.2f (%8.2f / %6s)%s", u->current / mib, u->peak / mib, budget,
+                   u->over_budget ? "!" : " ");
+            total[k].current += u->current;
+            total[k].peak += u->peak;
+        }
+        printf("\n");
+    }
+    // the summed peaks are an upper bound, subsystems need not peak together
+    printf("  %-10s %8.2f (%8.2f)%11s %8.2f (%8.2f)\n", "total",
+           total[MEM_CPU].current / mib, total[MEM_CPU].peak / mib, "",
+           total[MEM_GPU].current / mib, total[MEM_GPU].peak / mib);
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <stddef.h>
+#include "glad/glad.h"
+
+// Accounts CPU allocations and GL buffer, texture and renderbuffer storage
+// per subsystem.
+// CPU blocks carry a small header with their size so frees can be booked;
+// GL objects are remembered by name, so re-specifying a buffer replaces its
+// old size instead of adding to it. GPU sizes are what was requested, the
+// driver may round up or keep extra copies.
+#define MEM_TRACK_GL_OBJECTS 256
+
+typedef enum {
+    MEM_TEXTURES,
+    MEM_MESHES,
+    MEM_ORBITS,
+    MEM_SIMULATION,
+    MEM_RENDERER,       // per-frame streaming buffers and render targets
+    MEM_TRANSIENT,      // arena backing stores
+    MEM_SUBSYSTEM_COUNT
+} MemSubsystem;
+
+typedef enum {
+    MEM_CPU,
+    MEM_GPU,
+    MEM_KIND_COUNT
+} MemKind;
+
+typedef struct {
+    size_t current;
+    size_t peak;
+    size_t budget;      // 0 means no budget
+    unsigned int live;  // blocks or GL objects currently held
+    int over_budget;    // warned already, cleared once usage drops back under
+} MemUsage;
+
+void MemTrackSetBudget(MemSubsystem subsystem, MemKind kind, size_t bytes);
+const MemUsage *MemTrackUsage(MemSubsystem subsystem, MemKind kind);
+
+void *MemTrackAlloc(MemSubsystem subsystem, size_t size);
+void *MemTrackRealloc(MemSubsystem subsystem, void *ptr, size_t size);
+void MemTrackFree(MemSubsystem subsystem, void *ptr);
+
+// glBufferData() on the buffer bound to target, booked against the subsystem
+void MemTrackBufferData(MemSubsystem subsystem, GLenum target, GLuint buffer,
+                        GLsizeiptr size, const void *data, GLenum usage);
+// books a texture's storage, see MemTrackTextureSize()
+void MemTrackTexture(MemSubsystem subsystem, GLuint texture, size_t bytes);
+size_t MemTrackTextureSize(int width, int height, int layers, int bytes_per_texel, int mipmapped);
+// glRenderbufferStorage() on the bound renderbuffer, booked against the subsystem
+void MemTrackRenderbufferStorage(MemSubsystem subsystem, GLuint renderbuffer, GLenum format,
+                                 int width, int height, int bytes_per_pixel);
+// call when a tracked buffer, texture or renderbuffer is deleted
+void MemTrackForgetBuffer(GLuint buffer);
+void MemTrackForgetTexture(GLuint texture);
+void MemTrackForgetRenderbuffer(GLuint renderbuffer);
+
+void MemTrackPrintReport(void);
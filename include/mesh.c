@@ -0,0 +1,822 @@
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mesh.h"
+#include "arena.h"
+#include "mem_track.h"
+#include "mesh_opt.h"
+#include "gl_state.h"
+#include "frame_stats.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+
+void MeshPoolInit(MeshPool *pool, MeshFormat format)
+{
+    pool->vertices = NULL;
+    pool->indices = NULL;
+    pool->vertex_count = pool->vertex_capacity = 0;
+    pool->index_count = pool->index_capacity = 0;
+    pool->max_mesh_vertices = 0;
+    pool->dirty = 0;
+    pool->format = pool->uploaded_format = format;
+    pool->index_type = GL_UNSIGNED_INT;
+    pool->index_size = sizeof(GLuint);
+    pool->VAO = pool->VBO = pool->EBO = 0;
+}
+
+static int reserve(void **buffer, int *capacity, int needed, size_t element_size)
+{
+    if (needed <= *capacity)
+        return 0;
+
+    int new_capacity = *capacity ? *capacity : 1024;
+    while (new_capacity < needed)
+        new_capacity *= 2;
+
+    void *grown = MemTrackRealloc(MEM_MESHES, *buffer, new_capacity * element_size);
+    if (!grown) {
+        perror("error allocating");
+        return 1;
+    }
+    *buffer = grown;
+    *capacity = new_capacity;
+    return 0;
+}
+
+int MeshPoolAdd(MeshPool *pool, const Vertex *vertices, int vertex_count,
+                const GLuint *indices, int index_count, Mesh *mesh_out)
+{
+    if (reserve((void **)&pool->vertices, &pool->vertex_capacity,
+                pool->vertex_count + vertex_count, sizeof(Vertex)))
+        return 1;
+    if (reserve((void **)&pool->indices, &pool->index_capacity,
+                pool->index_count + index_count, sizeof(GLuint)))
+        return 1;
+
+    // indices stay local to the mesh, base_vertex offsets them at draw time
+    Vertex *mesh_vertices = &pool->vertices[pool->vertex_count];
+    GLuint *mesh_indices = &pool->indices[pool->index_count];
+    for (int i = 0; i < vertex_count; i++)
+        mesh_vertices[i] = vertices[i];
+    for (int i = 0; i < index_count; i++)
+        mesh_indices[i] = indices[i];
+
+    // every mesh is reordered for the post-transform cache and vertex fetch
+    MeshOptimize(mesh_vertices, vertex_count, mesh_indices, index_count);
+
+    mesh_out->first_index = pool->index_count;
+    mesh_out->index_count = index_count;
+    mesh_out->base_vertex = pool->vertex_count;
+
+    pool->vertex_count += vertex_count;
+    pool->index_count += index_count;
+    if (vertex_count > pool->max_mesh_vertices)
+        pool->max_mesh_vertices = vertex_count;
+    pool->dirty = 1;
+    return 0;
+}
+
+int MeshPoolAddSphere(MeshPool *pool, SphereGenerator generator, float radius,
+                      int slices, int stacks, Mesh *mesh_out)
+{
+    ArenaMarker mark = ArenaMark(&scratch_arena);
+    Vertex *vertices = NULL;
+    GLuint *indices = NULL;
+    int vertex_count = 0;
+    int index_count = 0;
+
+    switch (generator) {
+        case SPHERE_ICOSPHERE:
+            generate_icosphere_indexed(radius, slices, &vertices, &vertex_count, &indices, &index_count);
+            break;
+        case SPHERE_CUBE:
+            generate_cube_sphere_indexed(radius, slices, &vertices, &vertex_count, &indices, &index_count);
+            break;
+        case SPHERE_UV:
+        default:
+            generate_sphere_indexed(radius, slices, stacks, &vertices, &vertex_count, &indices, &index_count);
+            break;
+    }
+    int result = 1;
+    if (vertices && indices && vertex_count > 0 && index_count > 0)
+        result = MeshPoolAdd(pool, vertices, vertex_count, indices, index_count, mesh_out);
+
+    // the generator's buffers and everything it used along the way
+    ArenaRelease(&scratch_arena, mark);
+    return result;
+}
+
+void MeshRegistryInit(MeshRegistry *registry, MeshPool *pool)
+{
+    registry->pool = pool;
+    registry->count = 0;
+    registry->hits = 0;
+    registry->misses = 0;
+}
+
+int MeshRegistryAcquireSphere(MeshRegistry *registry, SphereGenerator generator, float radius,
+                              int slices, int stacks, Mesh *mesh_out)
+{
+    // only the UV sphere has a stack count, don't let it split the key
+    if (generator != SPHERE_UV)
+        stacks = 0;
+
+    for (int i = 0; i < registry->count; i++) {
+        MeshRegistryEntry *entry = &registry->entries[i];
+        if (entry->generator == generator && entry->radius == radius
+            && entry->slices == slices && entry->stacks == stacks) {
+            entry->references++;
+            registry->hits++;
+            *mesh_out = entry->mesh;
+            return i;
+        }
+    }
+
+    if (registry->count >= MESH_REGISTRY_CAPACITY) {
+        fprintf(stderr, "mesh registry full\n");
+        return -1;
+    }
+    MeshRegistryEntry *entry = &registry->entries[registry->count];
+    if (MeshPoolAddSphere(registry->pool, generator, radius, slices, stacks, &entry->mesh))
+        return -1;
+
+    entry->generator = generator;
+    entry->radius = radius;
+    entry->slices = slices;
+    entry->stacks = stacks;
+    entry->references = 1;
+    registry->misses++;
+    *mesh_out = entry->mesh;
+    return registry->count++;
+}
+
+void MeshRegistryRelease(MeshRegistry *registry, int handle)
+{
+    if (handle < 0 || handle >= registry->count || registry->entries[handle].references <= 0)
+        return;
+    registry->entries[handle].references--;
+}
+
+void MeshRegistryPrint(const MeshRegistry *registry)
+{
+    static const char *generator_names[] = {"uv", "icosphere", "cube"};
+
+    printf("mesh registry: %d meshes, %d requests served from cache\n", registry->misses, registry->hits);
+    for (int i = 0; i < registry->count; i++) {
+        const MeshRegistryEntry *entry = &registry->entries[i];
+        printf("  %-9s r=%g %dx%d: %u indices, %d references\n", generator_names[entry->generator],
+               entry->radius, entry->slices, entry->stacks, entry->mesh.index_count, entry->references);
+    }
+}
+
+// The compact layout only holds unit vectors whose normal is the position,
+// which is what the sphere generators produce at radius 1.
+static int fits_compact(const MeshPool *pool)
+{
+    for (int i = 0; i < pool->vertex_count; i++) {
+        const Vertex *v = &pool->vertices[i];
+        for (int c = 0; c < 3; c++) {
+            if (fabsf(v->position[c]) > 1.0f || fabsf(v->position[c] - v->normal[c]) > 1e-4f)
+                return 0;
+        }
+        if (fabsf(v->texCoord[0]) > 1.0f || fabsf(v->texCoord[1]) > 1.0f)
+            return 0;
+    }
+    return 1;
+}
+
+static int16_t to_snorm16(float value)
+{
+    return (int16_t)lrintf(value * 32767.0f);
+}
+
+static void print_format_comparison(const MeshPool *pool)
+{
+    double vertices = pool->vertex_count, indices = pool->index_count;
+    double full = vertices * sizeof(Vertex) + indices * sizeof(GLuint);
+    double compact = vertices * sizeof(CompactVertex)
+                   + indices * (pool->max_mesh_vertices < 0xFFFF ? sizeof(GLushort) : sizeof(GLuint));
+
+    printf("mesh pool: %d vertices, %d indices, using %s format\n", pool->vertex_count, pool->index_count,
+           pool->uploaded_format == MESH_FORMAT_COMPACT ? "compact" : "full");
+    printf("  full    %2zu B/vertex, %zu B/index: %.1f KiB\n",
+           sizeof(Vertex), sizeof(GLuint), full / 1024.0);
+    printf("  compact %2zu B/vertex, %zu B/index: %.1f KiB (%.0f%% of the vertex fetch bandwidth)\n",
+           sizeof(CompactVertex), pool->max_mesh_vertices < 0xFFFF ? sizeof(GLushort) : sizeof(GLuint),
+           compact / 1024.0, 100.0 * sizeof(CompactVertex) / sizeof(Vertex));
+}
+
+static void upload_full(const MeshPool *pool)
+{
+    MemTrackBufferData(MEM_MESHES, GL_ARRAY_BUFFER, pool->VBO, pool->vertex_count * sizeof(Vertex),
+                       pool->vertices, GL_STATIC_DRAW);
+
+    // Position attribute (location 0)
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+    // Normal attribute (location 1)
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+    // Texture coordinate attribute (location 2)
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
+}
+
+static int upload_compact(const MeshPool *pool)
+{
+    CompactVertex *packed = ArenaAlloc(&scratch_arena, pool->vertex_count * sizeof(CompactVertex));
+    if (!packed) {
+        perror("error allocating");
+        return 1;
+    }
+    for (int i = 0; i < pool->vertex_count; i++) {
+        const Vertex *v = &pool->vertices[i];
+        packed[i] = (CompactVertex) {
+            {to_snorm16(v->position[0]), to_snorm16(v->position[1]), to_snorm16(v->position[2]), 0},
+            {to_snorm16(v->texCoord[0]), to_snorm16(v->texCoord[1])},
+        };
+    }
+    MemTrackBufferData(MEM_MESHES, GL_ARRAY_BUFFER, pool->VBO, pool->vertex_count * sizeof(CompactVertex),
+                       packed, GL_STATIC_DRAW);
+    ArenaFree(&scratch_arena, packed);
+
+    // Position and normal read the same data (locations 0 and 1)
+    glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, position));
+    glVertexAttribPointer(1, 3, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, position));
+    // Texture coordinate attribute (location 2)
+    glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, texCoord));
+    return 0;
+}
+
+static void upload_indices(MeshPool *pool)
+{
+    // indices are local to their mesh, so 16 bits are enough as long as
+    // no single mesh has more vertices, whatever the pool total is
+    GLushort *narrow = NULL;
+    if (pool->uploaded_format == MESH_FORMAT_COMPACT && pool->max_mesh_vertices < 0xFFFF)
+        narrow = ArenaAlloc(&scratch_arena, pool->index_count * sizeof(GLushort));
+
+    if (!narrow) {
+        pool->index_type = GL_UNSIGNED_INT;
+        pool->index_size = sizeof(GLuint);
+        MemTrackBufferData(MEM_MESHES, GL_ELEMENT_ARRAY_BUFFER, pool->EBO, pool->index_count * sizeof(GLuint),
+                           pool->indices, GL_STATIC_DRAW);
+        return;
+    }
+    for (int i = 0; i < pool->index_count; i++)
+        narrow[i] = (GLushort)pool->indices[i];
+    pool->index_type = GL_UNSIGNED_SHORT;
+    pool->index_size = sizeof(GLushort);
+    MemTrackBufferData(MEM_MESHES, GL_ELEMENT_ARRAY_BUFFER, pool->EBO, pool->index_count * sizeof(GLushort),
+                       narrow, GL_STATIC_DRAW);
+    ArenaFree(&scratch_arena, narrow);
+}
+
+// (Re)creates the GPU buffers from everything added so far. The CPU copies
+// are kept, so meshes added later can be uploaded with another call.
+void MeshPoolUpload(MeshPool *pool)
+{
+    if (pool->VAO && !pool->dirty)
+        return;
+    pool->dirty = 0;
+
+    if (!pool->VAO) {
+        glGenVertexArrays(1, &pool->VAO);
+        glGenBuffers(1, &pool->VBO);
+        glGenBuffers(1, &pool->EBO);
+    }
+
+    pool->uploaded_format = pool->format;
+    if (pool->format == MESH_FORMAT_COMPACT && !fits_compact(pool)) {
+        printf("mesh pool holds non-unit geometry, falling back to the full vertex format\n");
+        pool->uploaded_format = MESH_FORMAT_FULL;
+    }
+
+    FrameStatsNoteActivity(FRAME_ACTIVITY_MESH_UPLOAD);
+    GLStateBindVertexArray(pool->VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, pool->VBO);
+    if (pool->uploaded_format != MESH_FORMAT_COMPACT || upload_compact(pool)) {
+        pool->uploaded_format = MESH_FORMAT_FULL;
+        upload_full(pool);
+    }
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+
+    // the EBO binding is VAO state, so bind it while the VAO is bound
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool->EBO);
+    upload_indices(pool);
+
+    GLStateBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    print_format_comparison(pool);
+}
+
+// Generates unique vertices and indices for a sphere suitable for EBO rendering.
+// vertices_out and indices_out come from the scratch arena, the caller
+// rewinds it to a mark taken before the call once they are consumed.
+void generate_sphere_indexed(
+    float radius, int slices, int stacks,
+    Vertex **vertices_out, int *vertex_count_out,
+    GLuint **indices_out, int *index_count_out)
+{
+    // --- Input Validation ---
+    if (!vertices_out || !vertex_count_out || !indices_out || !index_count_out || slices < 3 || stacks < 2 || radius <= 0.0f) {
+        if (vertices_out) *vertices_out = NULL;
+        if (vertex_count_out) *vertex_count_out = 0;
+        if (indices_out) *indices_out = NULL;
+        if (index_count_out) *index_count_out = 0;
+        // Optionally print an error message here
+        return;
+    }
+
+    // --- Calculate buffer sizes ---
+    // Vertices: (slices + 1) vertices per stack ring * (stacks + 1) rings (incl. poles)
+    int numVertices = (slices + 1) * (stacks + 1);
+    // Indices: 2 triangles per quad * 3 indices per triangle = 6 indices per quad
+    //          slices quads per stack * stacks stacks
+    int numIndices = slices * stacks * 6;
+
+    // --- Allocate memory ---
+    Vertex *vertices = (Vertex*)ArenaAlloc(&scratch_arena, numVertices * sizeof(Vertex));
+    GLuint *indices = (GLuint*)ArenaAlloc(&scratch_arena, numIndices * sizeof(GLuint));
+
+    if (!vertices || !indices) {
+        // Allocation failed
+        ArenaFree(&scratch_arena, vertices); // NULL is ignored
+        ArenaFree(&scratch_arena, indices);
+        *vertices_out = NULL;
+        *vertex_count_out = 0;
+        *indices_out = NULL;
+        *index_count_out = 0;
+        return;
+    }
+
+    // --- Generate Unique Vertices ---
+    int vertexIndex = 0;
+    for (int i = 0; i <= stacks; ++i) { // Iterate through stacks (latitude) including poles
+        float stackAngle = i * M_PI / stacks; // theta (from 0 to PI)
+        float y = radius * cosf(stackAngle);
+        float xyRadius = radius * sinf(stackAngle); // Radius of the stack ring in the xy-plane
+
+        for (int j = 0; j <= slices; ++j) { // Iterate through slices (longitude) including seam vertex
+            float sliceAngle = j * 2.0f * M_PI / slices; // phi (from 0 to 2*PI)
+
+            // Vertex position
+            float x = xyRadius * cosf(sliceAngle);
+            float z = xyRadius * sinf(sliceAngle);
+            vertices[vertexIndex].position[0] = x;
+            vertices[vertexIndex].position[1] = y;
+            vertices[vertexIndex].position[2] = z;
+
+            // Normal (for a sphere centered at origin, it's the normalized position)
+            float invLen = 1.0f / radius; // Assuming radius > 0
+            vertices[vertexIndex].normal[0] = x * invLen;
+            vertices[vertexIndex].normal[1] = y * invLen;
+            vertices[vertexIndex].normal[2] = z * invLen;
+
+            // Texture coordinates (Spherical mapping)
+            vertices[vertexIndex].texCoord[0] = (float)j / slices; // U: 0 to 1
+            vertices[vertexIndex].texCoord[1] = (float)i / stacks; // V: 0 to 1
+
+            vertexIndex++;
+        }
+    }
+
+    // --- Generate Indices ---
+    int indexIndex = 0;
+    for (int i = 0; i < stacks; ++i) { // Iterate through stack bands
+        // Calculate the starting vertex index for the current and next stack rings
+        GLuint k1 = i * (slices + 1); // Start index of current stack
+        GLuint k2 = k1 + (slices + 1); // Start index of next stack
+
+        for (int j = 0; j < slices; ++j, ++k1, ++k2) {
+            // For each slice, form a quad using vertices from the current (k1) and next (k2) stack rings
+            // Vertices forming the quad: k1, k2, k1+1, k2+1
+            // Need to handle the wrap-around for the last slice? No, because we generated j <= slices vertices.
+            // k1+1 will correctly point to the seam vertex when j = slices-1.
+
+            // Triangle 1: (k1, k2, k1+1)
+            indices[indexIndex++] = k1;
+            indices[indexIndex++] = k2;
+            indices[indexIndex++] = k1 + 1;
+
+            // Triangle 2: (k1+1, k2, k2+1)
+            indices[indexIndex++] = k1 + 1;
+            indices[indexIndex++] = k2;
+            indices[indexIndex++] = k2 + 1;
+        }
+    }
+
+    // --- Set output parameters ---
+    *vertices_out = vertices;
+    *vertex_count_out = numVertices;
+    *indices_out = indices;
+    *index_count_out = numIndices;
+
+    // Caller is responsible for freeing vertices and indices!
+}
+
+// Texture coordinates of a unit direction, the same mapping the UV sphere
+// uses: u follows the longitude atan2(z, x), v runs from +y (0) to -y (1).
+static void sphere_uv(const float *n, float *uv)
+{
+    float u = atan2f(n[2], n[0]) / (2.0f * M_PI);
+    if (u < 0.0f)
+        u += 1.0f;
+    float y = n[1] < -1.0f ? -1.0f : (n[1] > 1.0f ? 1.0f : n[1]);
+    uv[0] = u;
+    uv[1] = acosf(y) / M_PI;
+}
+
+static void set_sphere_vertex(Vertex *vertex, const float *direction, float radius)
+{
+    for (int c = 0; c < 3; c++) {
+        vertex->position[c] = direction[c] * radius;
+        vertex->normal[c] = direction[c];
+    }
+    sphere_uv(direction, vertex->texCoord);
+}
+
+// generate_sphere_indexed() winds its triangles clockwise seen from outside,
+// the other generators follow it
+static int winds_like_uv_sphere(const float *a, const float *b, const float *c)
+{
+    float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    float e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    float n[3] = {
+        e1[1] * e2[2] - e1[2] * e2[1],
+        e1[2] * e2[0] - e1[0] * e2[2],
+        e1[0] * e2[1] - e1[1] * e2[0],
+    };
+    return n[0] * (a[0] + b[0] + c[0]) + n[1] * (a[1] + b[1] + c[1]) + n[2] * (a[2] + b[2] + c[2]) <= 0.0f;
+}
+
+static int is_pole(const Vertex *vertex)
+{
+    return fabsf(vertex->normal[1]) > 1.0f - 1e-6f;
+}
+
+// Generators that do not follow meridians leave triangles straddling the
+// u = 0/1 seam, and pole vertices whose u is meaningless. Straddling
+// triangles get copies of their high-u corners at u - 1 (the textures
+// repeat in s), and every triangle touching a pole gets its own pole vertex
+// at the mean u of its other corners.
+static int fix_uv_seams(Vertex **vertices_io, int *vertex_count_io, GLuint *indices, int index_count)
+{
+    int original_count = *vertex_count_io;
+    Vertex *vertices = ArenaRealloc(&scratch_arena, *vertices_io, original_count * sizeof(Vertex),
+                                    (original_count + index_count) * sizeof(Vertex));
+    int *shifted = ArenaAlloc(&scratch_arena, original_count * sizeof(int));
+    if (!vertices || !shifted) {
+        perror("error allocating");
+        if (vertices)
+            *vertices_io = vertices;
+        ArenaFree(&scratch_arena, shifted);
+        return 1;
+    }
+    for (int i = 0; i < original_count; i++)
+        shifted[i] = -1;
+
+    int count = original_count;
+    for (int t = 0; t < index_count; t += 3) {
+        GLuint *tri = &indices[t];
+        float low = 1.0f, high = 0.0f;
+        for (int k = 0; k < 3; k++) {
+            if (is_pole(&vertices[tri[k]]))
+                continue;
+            float u = vertices[tri[k]].texCoord[0];
+            low = u < low ? u : low;
+            high = u > high ? u : high;
+        }
+
+        if (high - low > 0.5f) {
+            for (int k = 0; k < 3; k++) {
+                GLuint v = tri[k];
+                if (is_pole(&vertices[v]) || vertices[v].texCoord[0] <= 0.5f)
+                    continue;
+                if (shifted[v] < 0) {
+                    vertices[count] = vertices[v];
+                    vertices[count].texCoord[0] -= 1.0f;
+                    shifted[v] = count++;
+                }
+                tri[k] = shifted[v];
+            }
+        }
+
+        for (int k = 0; k < 3; k++) {
+            if (!is_pole(&vertices[tri[k]]))
+                continue;
+            float u = 0.5f * (vertices[tri[(k + 1) % 3]].texCoord[0] + vertices[tri[(k + 2) % 3]].texCoord[0]);
+            vertices[count] = vertices[tri[k]];
+            vertices[count].texCoord[0] = u;
+            tri[k] = count++;
+        }
+    }
+
+    ArenaFree(&scratch_arena, shifted);
+    Vertex *trimmed = ArenaRealloc(&scratch_arena, vertices, (original_count + index_count) * sizeof(Vertex),
+                                     count * sizeof(Vertex));
+    *vertices_io = trimmed ? trimmed : vertices;
+    *vertex_count_io = count;
+    return 0;
+}
+
+// open-addressed map from an undirected edge to the index of its midpoint
+typedef struct {
+    uint64_t *keys;
+    GLuint *values;
+    int mask;
+} EdgeMap;
+
+static GLuint edge_midpoint(EdgeMap *map, float (*directions)[3], int *direction_count, GLuint a, GLuint b)
+{
+    uint64_t key = a < b ? ((uint64_t)a << 32 | b) : ((uint64_t)b << 32 | a);
+    int slot = (int)((key * 0x9E3779B97F4A7C15ull) >> 40) & map->mask;
+    while (map->keys[slot] != UINT64_MAX) {
+        if (map->keys[slot] == key)
+            return map->values[slot];
+        slot = (slot + 1) & map->mask;
+    }
+
+    GLuint index = (*direction_count)++;
+    float *d = directions[index];
+    for (int c = 0; c < 3; c++)
+        d[c] = directions[a][c] + directions[b][c];
+    float inv = 1.0f / sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    for (int c = 0; c < 3; c++)
+        d[c] *= inv;
+
+    map->keys[slot] = key;
+    map->values[slot] = index;
+    return index;
+}
+
+// Subdivided icosahedron, every level splits each triangle in four, so
+// triangles stay within a few percent of the same size everywhere. Poles
+// sit on vertices so their texture coordinates can be fixed up.
+void generate_icosphere_indexed(
+    float radius, int subdivisions,
+    Vertex **vertices_out, int *vertex_count_out,
+    GLuint **indices_out, int *index_count_out)
+{
+    *vertices_out = NULL;
+    *indices_out = NULL;
+    *vertex_count_out = 0;
+    *index_count_out = 0;
+    if (subdivisions < 0 || subdivisions > 8 || radius <= 0.0f)
+        return;
+
+    int final_faces = 20 << (2 * subdivisions);
+    int final_vertices = 10 * (1 << (2 * subdivisions)) + 2;
+
+    float (*directions)[3] = ArenaAlloc(&scratch_arena, final_vertices * sizeof(*directions));
+    GLuint *faces = ArenaAlloc(&scratch_arena, final_faces * 3 * sizeof(GLuint));
+    GLuint *next_faces = ArenaAlloc(&scratch_arena, final_faces * 3 * sizeof(GLuint));
+    if (!directions || !faces || !next_faces) {
+        perror("error allocating");
+        ArenaFree(&scratch_arena, directions);
+        ArenaFree(&scratch_arena, faces);
+        ArenaFree(&scratch_arena, next_faces);
+        return;
+    }
+
+    // icosahedron with vertices on the poles and two rings of five at
+    // +-atan(1/2) latitude, the lower ring offset by 36 degrees
+    int direction_count = 0;
+    float ring_latitude = atanf(0.5f);
+    directions[direction_count][0] = 0;
+    directions[direction_count][1] = 1;
+    directions[direction_count++][2] = 0;
+    for (int ring = 0; ring < 2; ring++) {
+        float latitude = ring == 0 ? ring_latitude : -ring_latitude;
+        for (int i = 0; i < 5; i++) {
+            float longitude = (i * 72.0f + ring * 36.0f) * M_PI / 180.0f;
+            directions[direction_count][0] = cosf(latitude) * cosf(longitude);
+            directions[direction_count][1] = sinf(latitude);
+            directions[direction_count++][2] = cosf(latitude) * sinf(longitude);
+        }
+    }
+    directions[direction_count][0] = 0;
+    directions[direction_count][1] = -1;
+    directions[direction_count++][2] = 0;
+
+    int face_count = 0;
+    for (int i = 0; i < 5; i++) {
+        GLuint upper = 1 + i, upper_next = 1 + (i + 1) % 5;
+        GLuint lower = 6 + i, lower_next = 6 + (i + 1) % 5;
+        GLuint base[4][3] = {
+            {0, upper, upper_next},
+            {upper, lower, upper_next},
+            {upper_next, lower, lower_next},
+            {11, lower_next, lower},
+        };
+        for (int f = 0; f < 4; f++) {
+            GLuint *face = &faces[3 * face_count++];
+            face[0] = base[f][0];
+            if (winds_like_uv_sphere(directions[base[f][0]], directions[base[f][1]], directions[base[f][2]])) {
+                face[1] = base[f][1];
+                face[2] = base[f][2];
+            } else {
+                face[1] = base[f][2];
+                face[2] = base[f][1];
+            }
+        }
+    }
+
+    for (int level = 0; level < subdivisions; level++) {
+        int edges = face_count * 3 / 2;
+        int capacity = 1;
+        while (capacity < 2 * edges)
+            capacity <<= 1;
+        ArenaMarker level_mark = ArenaMark(&scratch_arena);
+        EdgeMap map = {ArenaAlloc(&scratch_arena, capacity * sizeof(uint64_t)),
+                       ArenaAlloc(&scratch_arena, capacity * sizeof(GLuint)), capacity - 1};
+        if (!map.keys || !map.values) {
+            perror("error allocating");
+            ArenaRelease(&scratch_arena, level_mark);
+            ArenaFree(&scratch_arena, directions);
+            ArenaFree(&scratch_arena, faces);
+            ArenaFree(&scratch_arena, next_faces);
+            return;
+        }
+        memset(map.keys, 0xFF, capacity * sizeof(uint64_t));
+
+        // each triangle splits into its corners and the middle one, keeping its winding
+        for (int f = 0; f < face_count; f++) {
+            GLuint a = faces[3 * f], b = faces[3 * f + 1], c = faces[3 * f + 2];
+            GLuint ab = edge_midpoint(&map, directions, &direction_count, a, b);
+            GLuint bc = edge_midpoint(&map, directions, &direction_count, b, c);
+            GLuint ca = edge_midpoint(&map, directions, &direction_count, c, a);
+            GLuint split[12] = {a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca};
+            memcpy(&next_faces[12 * f], split, sizeof(split));
+        }
+        face_count *= 4;
+        GLuint *swap = faces;
+        faces = next_faces;
+        next_faces = swap;
+        ArenaRelease(&scratch_arena, level_mark);
+    }
+    ArenaFree(&scratch_arena, next_faces);
+
+    Vertex *vertices = ArenaAlloc(&scratch_arena, direction_count * sizeof(Vertex));
+    if (!vertices) {
+        perror("error allocating");
+        ArenaFree(&scratch_arena, directions);
+        ArenaFree(&scratch_arena, faces);
+        return;
+    }
+    for (int i = 0; i < direction_count; i++)
+        set_sphere_vertex(&vertices[i], directions[i], radius);
+    ArenaFree(&scratch_arena, directions);
+
+    int vertex_count = direction_count;
+    if (fix_uv_seams(&vertices, &vertex_count, faces, face_count * 3)) {
+        ArenaFree(&scratch_arena, vertices);
+        ArenaFree(&scratch_arena, faces);
+        return;
+    }
+
+    *vertices_out = vertices;
+    *vertex_count_out = vertex_count;
+    *indices_out = faces;
+    *index_count_out = face_count * 3;
+}
+
+// Normalised cube: each face is a resolution x resolution grid, warped with
+// tan() so the grid is equal-angle and cells end up close to uniform once
+// projected onto the sphere (a plain normalised cube is ~5x denser at the
+// face corners).
+void generate_cube_sphere_indexed(
+    float radius, int resolution,
+    Vertex **vertices_out, int *vertex_count_out,
+    GLuint **indices_out, int *index_count_out)
+{
+    *vertices_out = NULL;
+    *indices_out = NULL;
+    *vertex_count_out = 0;
+    *index_count_out = 0;
+    if (resolution < 1 || radius <= 0.0f)
+        return;
+
+    int row = resolution + 1;
+    int vertex_count = 6 * row * row;
+    int index_count = 6 * resolution * resolution * 6;
+    Vertex *vertices = ArenaAlloc(&scratch_arena, vertex_count * sizeof(Vertex));
+    GLuint *indices = ArenaAlloc(&scratch_arena, index_count * sizeof(GLuint));
+    if (!vertices || !indices) {
+        perror("error allocating");
+        ArenaFree(&scratch_arena, vertices);
+        ArenaFree(&scratch_arena, indices);
+        return;
+    }
+
+    // face normal and the two in-face axes for +X, -X, +Y, -Y, +Z, -Z
+    static const float axes[6][3][3] = {
+        {{ 1, 0, 0}, {0, 0, -1}, {0, 1, 0}},
+        {{-1, 0, 0}, {0, 0,  1}, {0, 1, 0}},
+        {{0,  1, 0}, {1, 0,  0}, {0, 0, -1}},
+        {{0, -1, 0}, {1, 0,  0}, {0, 0,  1}},
+        {{0, 0,  1}, {1, 0,  0}, {0, 1, 0}},
+        {{0, 0, -1}, {-1, 0, 0}, {0, 1, 0}},
+    };
+
+    int v = 0, k = 0;
+    for (int face = 0; face < 6; face++) {
+        const float (*axis)[3] = axes[face];
+        int face_base = v;
+        for (int j = 0; j <= resolution; j++) {
+            float t = tanf(((float)j / resolution * 2.0f - 1.0f) * M_PI / 4.0f);
+            for (int i = 0; i <= resolution; i++) {
+                float s = tanf(((float)i / resolution * 2.0f - 1.0f) * M_PI / 4.0f);
+                float d[3];
+                for (int c = 0; c < 3; c++)
+                    d[c] = axis[0][c] + s * axis[1][c] + t * axis[2][c];
+                float inv = 1.0f / sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+                for (int c = 0; c < 3; c++)
+                    d[c] *= inv;
+                set_sphere_vertex(&vertices[v++], d, radius);
+            }
+        }
+
+        for (int j = 0; j < resolution; j++) {
+            for (int i = 0; i < resolution; i++) {
+                GLuint a = face_base + j * row + i;
+                GLuint quad[2][3] = {{a, a + row, a + 1}, {a + 1, a + row, a + row + 1}};
+                for (int q = 0; q < 2; q++) {
+                    const float *p0 = vertices[quad[q][0]].normal;
+                    const float *p1 = vertices[quad[q][1]].normal;
+                    const float *p2 = vertices[quad[q][2]].normal;
+                    int keep = winds_like_uv_sphere(p0, p1, p2);
+                    indices[k++] = quad[q][0];
+                    indices[k++] = quad[q][keep ? 1 : 2];
+                    indices[k++] = quad[q][keep ? 2 : 1];
+                }
+            }
+        }
+    }
+
+    if (fix_uv_seams(&vertices, &vertex_count, indices, index_count)) {
+        ArenaFree(&scratch_arena, vertices);
+        ArenaFree(&scratch_arena, indices);
+        return;
+    }
+
+    *vertices_out = vertices;
+    *vertex_count_out = vertex_count;
+    *indices_out = indices;
+    *index_count_out = index_count;
+}
+
+// A flat triangle strays furthest from the sphere at its circumcentre, by
+// r (1 - cos(rho)) where rho is the angular circumradius. These pick the
+// coarsest detail whose largest triangles stay under max_error.
+void sphere_detail_for_error(SphereGenerator generator, float radius, float max_error,
+                             int *slices_out, int *stacks_out)
+{
+    float ratio = 1.0f - max_error / radius;
+    float rho = acosf(ratio < -1.0f ? -1.0f : ratio);
+    int detail = 0;
+
+    switch (generator) {
+        case SPHERE_ICOSPHERE: {
+            // near-equilateral, rho = edge / sqrt(3); the icosahedron's
+            // edges span ~63.4 degrees and every level halves them
+            float edge = 1.1071487f;
+            while (edge > sqrtf(3.0f) * rho && detail < 8) {
+                edge *= 0.5f;
+                detail++;
+            }
+            *slices_out = *stacks_out = detail;
+            return;
+        }
+        case SPHERE_CUBE:
+            // right triangles of a square equal-angle cell, rho = cell / sqrt(2)
+            detail = (int)ceilf((M_PI / 2.0f) / (sqrtf(2.0f) * rho));
+            *slices_out = *stacks_out = detail < 1 ? 1 : detail;
+            return;
+        case SPHERE_UV:
+        default:
+            // square cells on the equator (stacks = slices / 2) are the
+            // largest, rho = half their diagonal
+            detail = (int)ceilf(sqrtf(2.0f) * M_PI / rho);
+            *slices_out = detail < 3 ? 3 : detail;
+            *stacks_out = *slices_out / 2 < 2 ? 2 : *slices_out / 2;
+            return;
+    }
+}
+
+int sphere_triangle_count(SphereGenerator generator, int slices, int stacks)
+{
+    switch (generator) {
+        case SPHERE_ICOSPHERE: return 20 << (2 * slices);
+        case SPHERE_CUBE:      return 12 * slices * slices;
+        case SPHERE_UV:
+        default:               return 2 * slices * stacks;
+    }
+}
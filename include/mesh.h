@@ -0,0 +1,118 @@
+#pragma once
+#include <stdint.h>
+#include "glad/glad.h"
+
+typedef struct {
+    float position[3];
+    float normal[3];
+    float texCoord[2];
+} Vertex;
+
+// Packed layout for unit spheres, 12 bytes instead of 32: the normal of a
+// unit sphere is its position, so attribute 1 reads the same snorm16 data
+// as attribute 0. Texture coordinates are snorm16 as well, because the
+// seam fix-up of the icosphere and cube sphere pushes u slightly below 0.
+typedef struct {
+    int16_t position[4];    // xyz snorm16, w is padding to keep 4-byte alignment
+    int16_t texCoord[2];
+} CompactVertex;
+
+typedef enum {
+    SPHERE_UV,              // slices x stacks latitude/longitude grid
+    SPHERE_ICOSPHERE,       // slices = subdivision level, stacks unused
+    SPHERE_CUBE,            // slices = grid cells per cube face edge, stacks unused
+} SphereGenerator;
+
+typedef enum {
+    MESH_FORMAT_FULL,       // Vertex, 32-bit indices
+    MESH_FORMAT_COMPACT,    // CompactVertex, 16-bit indices when every mesh fits
+} MeshFormat;
+
+// A mesh is a range of the shared pool buffers, drawn with
+// glDrawElementsBaseVertex or as one command of a multi-draw.
+typedef struct {
+    GLuint first_index;
+    GLuint index_count;
+    GLint base_vertex;
+} Mesh;
+
+// All generated geometry lives in one VBO/EBO pair behind one VAO, so any
+// mesh can be drawn without rebinding and many meshes in a single call.
+// Meshes are appended on the CPU and sent to the GPU by MeshPoolUpload(),
+// which does nothing when no mesh was added since the last upload.
+typedef struct {
+    Vertex *vertices;
+    GLuint *indices;
+    int vertex_count;
+    int vertex_capacity;
+    int index_count;
+    int index_capacity;
+    int max_mesh_vertices;  // largest vertex count of a single mesh
+    int dirty;              // meshes added since the last upload
+
+    // requested format, and what the last upload could actually use
+    MeshFormat format;
+    MeshFormat uploaded_format;
+    GLenum index_type;
+    GLsizei index_size;
+
+    GLuint VAO;
+    GLuint VBO;
+    GLuint EBO;
+} MeshPool;
+
+// Generated meshes keyed by their generator parameters, so asking twice for
+// the same sphere returns the mesh already in the pool instead of building
+// and uploading it again. Entries are reference counted; the pool is
+// append-only, so an unreferenced entry stays cached for the next acquire.
+#define MESH_REGISTRY_CAPACITY 64
+
+typedef struct {
+    SphereGenerator generator;
+    float radius;
+    int slices;
+    int stacks;
+    Mesh mesh;
+    int references;
+} MeshRegistryEntry;
+
+typedef struct {
+    MeshPool *pool;
+    MeshRegistryEntry entries[MESH_REGISTRY_CAPACITY];
+    int count;
+    int hits;
+    int misses;
+} MeshRegistry;
+
+void MeshPoolInit(MeshPool *pool, MeshFormat format);
+int MeshPoolAdd(MeshPool *pool, const Vertex *vertices, int vertex_count,
+                const GLuint *indices, int index_count, Mesh *mesh_out);
+int MeshPoolAddSphere(MeshPool *pool, SphereGenerator generator, float radius,
+                      int slices, int stacks, Mesh *mesh_out);
+void MeshPoolUpload(MeshPool *pool);
+
+void MeshRegistryInit(MeshRegistry *registry, MeshPool *pool);
+// returns a handle for MeshRegistryRelease(), or -1 on failure
+int MeshRegistryAcquireSphere(MeshRegistry *registry, SphereGenerator generator, float radius,
+                              int slices, int stacks, Mesh *mesh_out);
+void MeshRegistryRelease(MeshRegistry *registry, int handle);
+void MeshRegistryPrint(const MeshRegistry *registry);
+
+// the generators return buffers from the scratch arena, see arena.h
+void generate_sphere_indexed(
+    float radius, int slices, int stacks,
+    Vertex **vertices_out, int *vertex_count_out,
+    GLuint **indices_out, int *index_count_out);
+void generate_icosphere_indexed(
+    float radius, int subdivisions,
+    Vertex **vertices_out, int *vertex_count_out,
+    GLuint **indices_out, int *index_count_out);
+void generate_cube_sphere_indexed(
+    float radius, int resolution,
+    Vertex **vertices_out, int *vertex_count_out,
+    GLuint **indices_out, int *index_count_out);
+
+// coarsest slices/stacks for the generator whose edges stay within max_error of the sphere
+void sphere_detail_for_error(SphereGenerator generator, float radius, float max_error,
+                             int *slices_out, int *stacks_out);
+int sphere_triangle_count(SphereGenerator generator, int slices, int stacks);
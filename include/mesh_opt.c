@@ -0,0 +1,274 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mesh_opt.h"
+#include "arena.h"
+
+// Forsyth's scoring parameters, the values from the original write-up
+#define FORSYTH_CACHE_SIZE 32
+#define CACHE_DECAY_POWER 1.5f
+#define LAST_TRI_SCORE 0.75f
+#define VALENCE_BOOST_SCALE 2.0f
+#define VALENCE_BOOST_POWER 0.5f
+
+
+MeshCacheStats MeshCacheAnalyze(const GLuint *indices, int index_count, int vertex_count)
+{
+    MeshCacheStats stats = {0, 0};
+    if (index_count < 3 || vertex_count <= 0)
+        return stats;
+
+    ArenaMarker mark = ArenaMark(&scratch_arena);
+    int *stamp = ArenaAlloc(&scratch_arena, vertex_count * sizeof(int));   // miss counter value when last loaded
+    char *referenced = ArenaAlloc(&scratch_arena, vertex_count);
+    if (!stamp || !referenced) {
+        perror("error allocating");
+        ArenaRelease(&scratch_arena, mark);
+        return stats;
+    }
+    memset(referenced, 0, vertex_count);
+
+    // a FIFO cache hit is a vertex loaded within the last MESH_OPT_CACHE_SIZE misses
+    int misses = 0, unique = 0;
+    for (int i = 0; i < vertex_count; i++)
+        stamp[i] = -MESH_OPT_CACHE_SIZE - 1;
+    for (int i = 0; i < index_count; i++) {
+        GLuint v = indices[i];
+        if (!referenced[v]) {
+            referenced[v] = 1;
+            unique++;
+        }
+        if (misses - stamp[v] > MESH_OPT_CACHE_SIZE) {
+            stamp[v] = misses;
+            misses++;
+        }
+    }
+
+    stats.acmr = (float)misses / (index_count / 3);
+    stats.atvr = (float)misses / unique;
+    ArenaRelease(&scratch_arena, mark);
+    return stats;
+}
+
+static float vertex_score(int cache_position, int remaining)
+{
+    if (remaining == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cache_position >= 0) {
+        if (cache_position < 3) {
+            // the triangle just emitted, its vertices get a fixed score so
+            // the next pick does not simply reuse the same edge every time
+            score = LAST_TRI_SCORE;
+        } else {
+            float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = powf(1.0f - (cache_position - 3) * scaler, CACHE_DECAY_POWER);
+        }
+    }
+    // vertices with few triangles left are finished off first
+    score += VALENCE_BOOST_SCALE * powf((float)remaining, -VALENCE_BOOST_POWER);
+    return score;
+}
+
+static int optimize_triangles(GLuint *indices, int index_count, int vertex_count)
+{
+    int triangle_count = index_count / 3;
+
+    ArenaMarker mark = ArenaMark(&scratch_arena);
+    int *valence = ArenaAlloc(&scratch_arena, vertex_count * sizeof(int));
+    int *adjacency_start = ArenaAlloc(&scratch_arena, (vertex_count + 1) * sizeof(int));
+    int *adjacency = ArenaAlloc(&scratch_arena, index_count * sizeof(int));
+    int *remaining = ArenaAlloc(&scratch_arena, vertex_count * sizeof(int));
+    int *cache_position = ArenaAlloc(&scratch_arena, vertex_count * sizeof(int));
+    float *score = ArenaAlloc(&scratch_arena, vertex_count * sizeof(float));
+    char *emitted = ArenaAlloc(&scratch_arena, triangle_count);
+    GLuint *output = ArenaAlloc(&scratch_arena, index_count * sizeof(GLuint));
+
+    int result = 1;
+    if (!valence || !adjacency_start || !adjacency || !remaining || !cache_position
+        || !score || !emitted || !output) {
+        perror("error allocating");
+        goto done;
+    }
+    memset(valence, 0, vertex_count * sizeof(int));
+    memset(emitted, 0, triangle_count);
+
+    // triangle lists per vertex, flattened
+    for (int i = 0; i < index_count; i++)
+        valence[indices[i]]++;
+    adjacency_start[0] = 0;
+    for (int v = 0; v < vertex_count; v++) {
+        adjacency_start[v + 1] = adjacency_start[v] + valence[v];
+        remaining[v] = valence[v];
+        valence[v] = 0;    // reused as the fill cursor
+        cache_position[v] = -1;
+    }
+    for (int t = 0; t < triangle_count; t++) {
+        for (int k = 0; k < 3; k++) {
+            GLuint v = indices[3 * t + k];
+            adjacency[adjacency_start[v] + valence[v]++] = t;
+        }
+    }
+
+    for (int v = 0; v < vertex_count; v++)
+        score[v] = vertex_score(-1, remaining[v]);
+
+    int best = -1;
+    float best_score = -1.0f;
+    for (int t = 0; t < triangle_count; t++) {
+        float s = score[indices[3 * t]] + score[indices[3 * t + 1]] + score[indices[3 * t + 2]];
+        if (s > best_score) {
+            best_score = s;
+            best = t;
+        }
+    }
+
+    // LRU cache with room for the three incoming vertices
+    int cache[FORSYTH_CACHE_SIZE + 3];
+    int cache_count = 0;
+    int scan_cursor = 0;
+
+    for (int out = 0; out < triangle_count; out++) {
+        if (best < 0) {
+            // nothing in the cache touches a live triangle, resume the linear scan
+            while (emitted[scan_cursor])
+                scan_cursor++;
+            best = scan_cursor;
+        }
+
+        int t = best;
+        emitted[t] = 1;
+        GLuint tri[3] = {indices[3 * t], indices[3 * t + 1], indices[3 * t + 2]};
+        for (int k = 0; k < 3; k++) {
+            output[3 * out + k] = tri[k];
+
+            // drop the triangle from the vertex's live list
+            GLuint v = tri[k];
+            int *list = &adjacency[adjacency_start[v]];
+            for (int i = 0; i < remaining[v]; i++) {
+                if (list[i] == t) {
+                    list[i] = list[remaining[v] - 1];
+                    break;
+                }
+            }
+            remaining[v]--;
+        }
+
+        // move the triangle's vertices to the front, everything else shifts back
+        int new_cache[FORSYTH_CACHE_SIZE + 3];
+        int new_count = 0;
+        for (int k = 0; k < 3; k++)
+            new_cache[new_count++] = tri[k];
+        for (int i = 0; i < cache_count; i++) {
+            int v = cache[i];
+            if (v != (int)tri[0] && v != (int)tri[1] && v != (int)tri[2])
+                new_cache[new_count++] = v;
+        }
+
+        // evicted vertices lose their cache score
+        for (int i = FORSYTH_CACHE_SIZE; i < new_count; i++) {
+            int v = new_cache[i];
+            cache_position[v] = -1;
+            score[v] = vertex_score(-1, remaining[v]);
+        }
+
+        if (new_count > FORSYTH_CACHE_SIZE)
+            new_count = FORSYTH_CACHE_SIZE;
+        memcpy(cache, new_cache, new_count * sizeof(int));
+        cache_count = new_count;
+
+        // rescore what is in the cache and pick the best triangle touching it
+        for (int i = 0; i < cache_count; i++) {
+            cache_position[cache[i]] = i;
+            score[cache[i]] = vertex_score(i, remaining[cache[i]]);
+        }
+        best = -1;
+        best_score = -1.0f;
+        for (int i = 0; i < cache_count; i++) {
+            int v = cache[i];
+            for (int j = 0; j < remaining[v]; j++) {
+                int u = adjacency[adjacency_start[v] + j];
+                float s = score[indices[3 * u]] + score[indices[3 * u + 1]] + score[indices[3 * u + 2]];
+                if (s > best_score) {
+                    best_score = s;
+                    best = u;
+                }
+            }
+        }
+    }
+
+    memcpy(indices, output, index_count * sizeof(GLuint));
+    result = 0;
+
+done:
+    ArenaRelease(&scratch_arena, mark);
+    return result;
+}
+
+// renumbers vertices in the order the index buffer first touches them
+static int optimize_fetch(Vertex *vertices, int vertex_count, GLuint *indices, int index_count)
+{
+    ArenaMarker mark = ArenaMark(&scratch_arena);
+    GLuint *remap = ArenaAlloc(&scratch_arena, vertex_count * sizeof(GLuint));
+    Vertex *reordered = ArenaAlloc(&scratch_arena, vertex_count * sizeof(Vertex));
+    if (!remap || !reordered) {
+        perror("error allocating");
+        ArenaRelease(&scratch_arena, mark);
+        return 1;
+    }
+
+    memset(remap, 0xFF, vertex_count * sizeof(GLuint));
+    GLuint next = 0;
+    for (int i = 0; i < index_count; i++) {
+        GLuint v = indices[i];
+        if (remap[v] == 0xFFFFFFFFu) {
+            remap[v] = next;
+            reordered[next++] = vertices[v];
+        }
+        indices[i] = remap[v];
+    }
+    // unreferenced vertices keep their data at the end
+    for (int v = 0; v < vertex_count; v++) {
+        if (remap[v] == 0xFFFFFFFFu)
+            reordered[next++] = vertices[v];
+    }
+
+    memcpy(vertices, reordered, vertex_count * sizeof(Vertex));
+    ArenaRelease(&scratch_arena, mark);
+    return 0;
+}
+
+int MeshOptimize(Vertex *vertices, int vertex_count, GLuint *indices, int index_count)
+{
+    if (index_count < 3 || vertex_count <= 0)
+        return 1;
+
+    GLuint *original = ArenaAlloc(&scratch_arena, index_count * sizeof(GLuint));
+    if (!original) {
+        perror("error allocating");
+        return 1;
+    }
+    memcpy(original, indices, index_count * sizeof(GLuint));
+
+    MeshCacheStats before = MeshCacheAnalyze(indices, index_count, vertex_count);
+    MeshCacheStats after = before;
+    if (optimize_triangles(indices, index_count, vertex_count) == 0)
+        after = MeshCacheAnalyze(indices, index_count, vertex_count);
+
+    // meshes small enough to sit in the cache whole can come out worse
+    if (after.acmr >= before.acmr) {
+        memcpy(indices, original, index_count * sizeof(GLuint));
+        after = before;
+    }
+    ArenaFree(&scratch_arena, original);
+
+    if (optimize_fetch(vertices, vertex_count, indices, index_count))
+        return 1;
+
+    printf("mesh %d vertices, %d triangles: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+           vertex_count, index_count / 3, before.acmr, after.acmr, before.atvr, after.atvr);
+    return 0;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "glad/glad.h"
+#include "mesh.h"
+
+// Post-transform cache simulated when measuring, a FIFO of this many
+// vertices is a fair stand-in for current hardware
+#define MESH_OPT_CACHE_SIZE 32
+
+typedef struct {
+    float acmr;     // transformed vertices per triangle, 0.5 is the ideal for closed meshes
+    float atvr;     // transformed vertices per referenced vertex, 1.0 is the ideal
+} MeshCacheStats;
+
+MeshCacheStats MeshCacheAnalyze(const GLuint *indices, int index_count, int vertex_count);
+
+// Reorders triangles for post-transform cache hits (Forsyth's linear-speed
+// algorithm), then renumbers vertices in first-use order so fetches walk
+// the vertex buffer linearly. Works in place; returns 0 on success.
+int MeshOptimize(Vertex *vertices, int vertex_count, GLuint *indices, int index_count);
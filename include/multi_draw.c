@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stddef.h>
+
+#include "multi_draw.h"
+#include "gl_caps.h"
+#include "gl_state.h"
+#include "mem_track.h"
+
+// batches over the same pool share its VAO, whose instance attributes read
+// from the buffer of whichever batch pointed them last
+static GLuint pointed_vao, pointed_buffer;
+
+
+static void point_instance_attributes(size_t base)
+{
+    for (int column = 0; column < 4; column++) {
+        glVertexAttribPointer(MULTI_DRAW_INSTANCE_LOCATION + column, 4, GL_FLOAT, GL_FALSE,
+                              sizeof(InstanceData),
+                              (void *)(base + offsetof(InstanceData, model) + column * sizeof(vec4)));
+    }
+    glVertexAttribPointer(MULTI_DRAW_INSTANCE_LOCATION + 4, 1, GL_FLOAT, GL_FALSE,
+                          sizeof(InstanceData), (void *)(base + offsetof(InstanceData, layer)));
+}
+
+void MultiDrawInit(MultiDraw *batch, const MeshPool *pool)
+{
+    batch->draw_count = 0;
+    batch->pool = pool;
+    glGenBuffers(1, &batch->instance_buffer);
+    batch->indirect_buffer = 0;
+
+    GLStateBindVertexArray(batch->pool->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, batch->instance_buffer);
+    MemTrackBufferData(MEM_RENDERER, GL_ARRAY_BUFFER, batch->instance_buffer, sizeof(batch->instances),
+                       NULL, GL_STREAM_DRAW);
+    point_instance_attributes(0);
+    pointed_vao = batch->pool->VAO;
+    pointed_buffer = batch->instance_buffer;
+    for (int i = 0; i < 5; i++) {
+        glEnableVertexAttribArray(MULTI_DRAW_INSTANCE_LOCATION + i);
+        glVertexAttribDivisor(MULTI_DRAW_INSTANCE_LOCATION + i, 1);
+    }
+    GLStateBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (gl_caps.multi_draw_indirect) {
+        glGenBuffers(1, &batch->indirect_buffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, batch->indirect_buffer);
+        MemTrackBufferData(MEM_RENDERER, GL_DRAW_INDIRECT_BUFFER, batch->indirect_buffer,
+                           sizeof(batch->commands), NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+}
+
+void MultiDrawReset(MultiDraw *batch)
+{
+    batch->draw_count = 0;
+}
+
+void MultiDrawAdd(MultiDraw *batch, Mesh mesh, mat4 model, float layer)
+{
+    if (batch->draw_count >= MULTI_DRAW_CAPACITY) {
+        fprintf(stderr, "multi-draw batch full, dropping draw\n");
+        return;
+    }
+
+    int i = batch->draw_count++;
+    batch->commands[i] = (DrawElementsIndirectCommand) {
+        mesh.index_count, 1, mesh.first_index, mesh.base_vertex, i
+    };
+    glm_mat4_copy(model, batch->instances[i].model);
+    batch->instances[i].layer = layer;
+}
+
+void MultiDrawSubmit(MultiDraw *batch)
+{
+    int n = batch->draw_count;
+    if (n == 0)
+        return;
+
+    // orphan and refill, the driver hands back fresh storage if the last
+    // frame's copy is still in flight
+    glBindBuffer(GL_ARRAY_BUFFER, batch->instance_buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(batch->instances), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, n * sizeof(InstanceData), batch->instances);
+
+    GLStateBindVertexArray(batch->pool->VAO);
+    if (pointed_vao != batch->pool->VAO || pointed_buffer != batch->instance_buffer) {
+        point_instance_attributes(0);
+        pointed_vao = batch->pool->VAO;
+        pointed_buffer = batch->instance_buffer;
+    }
+    GLenum index_type = batch->pool->index_type;
+    GLsizei index_size = batch->pool->index_size;
+
+    if (gl_caps.multi_draw_indirect) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, batch->indirect_buffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(batch->commands), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, n * sizeof(DrawElementsIndirectCommand), batch->commands);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, index_type, (void *)0, n, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    } else if (gl_caps.base_instance) {
+        for (int i = 0; i < n; i++) {
+            const DrawElementsIndirectCommand *c = &batch->commands[i];
+            glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, c->count, index_type,
+                (void *)(size_t)(c->first_index * index_size), 1, c->base_vertex, c->base_instance);
+        }
+    } else {
+        for (int i = 0; i < n; i++) {
+            const DrawElementsIndirectCommand *c = &batch->commands[i];
+            point_instance_attributes(c->base_instance * sizeof(InstanceData));
+            glDrawElementsBaseVertex(GL_TRIANGLES, c->count, index_type,
+                (void *)(size_t)(c->first_index * index_size), c->base_vertex);
+        }
+        point_instance_attributes(0);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
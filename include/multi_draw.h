@@ -0,0 +1,49 @@
+#pragma once
+#include <cglm/cglm.h>
+#include "glad/glad.h"
+#include "mesh.h"
+
+// Batches draws of pool meshes that share a program. Each draw gets one
+// InstanceData record, read by the vertex shader through instanced
+// attributes starting at MULTI_DRAW_INSTANCE_LOCATION:
+//   location 3..6  mat4 model
+//   location 7     float texture layer
+//
+// Submission picks the best path the context offers:
+//   GL 4.3 / ARB_multi_draw_indirect  one glMultiDrawElementsIndirect
+//   GL 4.2 / ARB_base_instance        a loop of base-instance draws
+//   GL 3.3                            a loop that re-points the instance attributes
+#define MULTI_DRAW_CAPACITY 256
+#define MULTI_DRAW_INSTANCE_LOCATION 3
+
+typedef struct {
+    mat4 model;
+    float layer;
+    float padding[3];
+} InstanceData;
+
+// layout fixed by the GL spec for indirect element draws
+typedef struct {
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint base_vertex;
+    GLuint base_instance;
+} DrawElementsIndirectCommand;
+
+typedef struct {
+    DrawElementsIndirectCommand commands[MULTI_DRAW_CAPACITY];
+    InstanceData instances[MULTI_DRAW_CAPACITY];
+    int draw_count;
+
+    const MeshPool *pool;
+    GLuint instance_buffer;
+    GLuint indirect_buffer;
+} MultiDraw;
+
+// adds the instance attributes to the pool's VAO
+void MultiDrawInit(MultiDraw *batch, const MeshPool *pool);
+void MultiDrawReset(MultiDraw *batch);
+void MultiDrawAdd(MultiDraw *batch, Mesh mesh, mat4 model, float layer);
+// expects the program to be bound; binds the pool VAO itself
+void MultiDrawSubmit(MultiDraw *batch);
@@ -0,0 +1,92 @@
+#include <math.h>
+#include <stdio.h>
+
+#include "orbit_lines.h"
+#include "gl_state.h"
+#include "frame_stats.h"
+#include "arena.h"
+#include "mem_track.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+
+void OrbitLinesInit(OrbitLines *orbits, int segments)
+{
+    orbits->segments = segments;
+    orbits->index_count = 0;
+
+    glGenVertexArrays(1, &orbits->VAO);
+    glGenBuffers(1, &orbits->VBO);
+    glGenBuffers(1, &orbits->EBO);
+
+    GLStateBindVertexArray(orbits->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, orbits->VBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, orbits->EBO);
+    // high (location = 0) and low (location = 1) halves of the position
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 2 * sizeof(vec3), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 2 * sizeof(vec3), (void*)sizeof(vec3));
+    glEnableVertexAttribArray(1);
+    GLStateBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // the restart index can never be a real vertex, so it stays on for every draw
+    glEnable(GL_PRIMITIVE_RESTART);
+    glPrimitiveRestartIndex(ORBIT_RESTART_INDEX);
+}
+
+void OrbitLinesSplit(const double position[3], vec3 high, vec3 low)
+{
+    for (int i = 0; i < 3; i++) {
+        high[i] = (float)position[i];
+        low[i] = (float)(position[i] - high[i]);
+    }
+}
+
+int OrbitLinesBuild(OrbitLines *orbits, const KeplerOrbits *elements)
+{
+    int count = elements->count;
+    int segments = orbits->segments;
+    int vertex_count = count * segments;
+    int index_count = count * (segments + 1);
+
+    ArenaMarker mark = ArenaMark(&scratch_arena);
+    vec3 *vertices = ArenaAlloc(&scratch_arena, 2 * vertex_count * sizeof(vec3));
+    GLuint *indices = ArenaAlloc(&scratch_arena, index_count * sizeof(GLuint));
+    if (!vertices || !indices) {
+        perror("error allocating");
+        ArenaRelease(&scratch_arena, mark);
+        return 1;
+    }
+
+    // even steps of eccentric anomaly put more points near periapsis,
+    // where the ellipse curves hardest
+    float angle_step = 2 * M_PI / segments;
+    int v = 0, k = 0;
+    for (int ring = 0; ring < count; ring++) {
+        for (int i = 0; i < segments; i++) {
+            double point[3];
+            KeplerOrbitPoint(elements, ring, i * angle_step, point);
+            indices[k++] = v;
+            OrbitLinesSplit(point, vertices[2 * v], vertices[2 * v + 1]);
+            v++;
+        }
+        indices[k++] = ORBIT_RESTART_INDEX;
+    }
+
+    FrameStatsNoteActivity(FRAME_ACTIVITY_MESH_UPLOAD);
+    GLStateBindVertexArray(orbits->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, orbits->VBO);
+    MemTrackBufferData(MEM_ORBITS, GL_ARRAY_BUFFER, orbits->VBO, 2 * vertex_count * sizeof(vec3),
+                       vertices, GL_STATIC_DRAW);
+    MemTrackBufferData(MEM_ORBITS, GL_ELEMENT_ARRAY_BUFFER, orbits->EBO, index_count * sizeof(GLuint),
+                       indices, GL_STATIC_DRAW);
+    GLStateBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    ArenaRelease(&scratch_arena, mark);
+    orbits->index_count = index_count;
+    return 0;
+}
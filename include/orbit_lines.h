@@ -0,0 +1,30 @@
+#pragma once
+#include <cglm/cglm.h>
+#include "glad/glad.h"
+#include "kepler.h"
+
+// Every orbit is baked as an ellipse into one vertex buffer and the
+// rings are separated by a primitive-restart index, so all orbits draw
+// with a single GL_LINE_LOOP call however many bodies are tracked.
+//
+// Rings span millions of units, more than a float resolves to the
+// kilometre, so each vertex is stored as a float plus the float remainder
+// of the double position. The vertex shader subtracts the camera, split
+// the same way, one half at a time; the high halves of nearby points are
+// close enough that their difference is exact, and the ring stays steady
+// against the bodies wherever the camera is.
+#define ORBIT_RESTART_INDEX 0xFFFFFFFFu
+
+typedef struct {
+    GLuint VAO;
+    GLuint VBO;
+    GLuint EBO;
+    int segments;       // vertices per ring
+    int index_count;
+} OrbitLines;
+
+void OrbitLinesInit(OrbitLines *orbits, int segments);
+// replaces all rings with one per body in elements, in world positions
+int OrbitLinesBuild(OrbitLines *orbits, const KeplerOrbits *elements);
+// a double position as a float and the float remainder, for the camera uniforms
+void OrbitLinesSplit(const double position[3], vec3 high, vec3 low);
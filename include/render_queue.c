@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "render_queue.h"
+#include "gl_state.h"
+
+#define PASS_BITS    4
+#define PROGRAM_BITS 12
+#define TEXTURE_BITS 16
+#define VAO_BITS     12
+#define DEPTH_BITS   20
+
+#define FIELD(value, bits, shift) (((uint64_t)(value) & ((1ull << (bits)) - 1)) << (shift))
+
+typedef struct {
+    GLboolean depth_test;
+    GLboolean depth_write;
+} PassState;
+
+static const PassState pass_states[RENDER_PASS_COUNT] = {
+    [RENDER_PASS_BACKGROUND] = {GL_FALSE, GL_FALSE},
+    [RENDER_PASS_OPAQUE]     = {GL_TRUE, GL_TRUE},
+    [RENDER_PASS_LINES]      = {GL_TRUE, GL_TRUE},
+};
+
+
+void RenderQueueInit(RenderQueue *queue, float far_plane)
+{
+    queue->count = 0;
+    queue->far_plane = far_plane;
+}
+
+void RenderQueueReset(RenderQueue *queue)
+{
+    queue->count = 0;
+}
+
+void RenderQueuePush(RenderQueue *queue, RenderPass pass, float depth, const RenderCommand *command)
+{
+    if (queue->count >= RENDER_QUEUE_CAPACITY) {
+        fprintf(stderr, "render queue full, dropping draw\n");
+        return;
+    }
+
+    float normalized = depth / queue->far_plane;
+    if (normalized < 0.0f)
+        normalized = 0.0f;
+    if (normalized > 1.0f)
+        normalized = 1.0f;
+    uint32_t quantized = (uint32_t)(normalized * ((1u << DEPTH_BITS) - 1));
+
+    int i = queue->count++;
+    queue->commands[i] = *command;
+    queue->keys[i] = FIELD(pass, PASS_BITS, 60)
+                   | FIELD(command->program, PROGRAM_BITS, 48)
+                   | FIELD(command->texture, TEXTURE_BITS, 32)
+                   | FIELD(command->vao, VAO_BITS, 20)
+                   | FIELD(quantized, DEPTH_BITS, 0);
+}
+
+// LSD radix sort of the key/index pairs, one byte per pass; bytes that are
+// equal across the whole queue are skipped, which is most of them
+void RenderQueueSort(RenderQueue *queue)
+{
+    int n = queue->count;
+
+    for (int i = 0; i < n; i++) {
+        queue->scratch_keys[0][i] = queue->keys[i];
+        queue->order[i] = i;
+    }
+    if (n < 2)
+        return;
+
+    uint64_t *src_keys = queue->scratch_keys[0], *dst_keys = queue->scratch_keys[1];
+    uint16_t *src_order = queue->order, *dst_order = queue->scratch_order;
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        unsigned int histogram[256] = {0};
+        for (int i = 0; i < n; i++)
+            histogram[(src_keys[i] >> shift) & 0xFF]++;
+        if (histogram[(src_keys[0] >> shift) & 0xFF] == (unsigned int)n)
+            continue;
+
+        unsigned int offset = 0;
+        for (int b = 0; b < 256; b++) {
+            unsigned int c = histogram[b];
+            histogram[b] = offset;
+            offset += c;
+        }
+        for (int i = 0; i < n; i++) {
+            unsigned int slot = histogram[(src_keys[i] >> shift) & 0xFF]++;
+            dst_keys[slot] = src_keys[i];
+            dst_order[slot] = src_order[i];
+        }
+
+        uint64_t *tk = src_keys; src_keys = dst_keys; dst_keys = tk;
+        uint16_t *to = src_order; src_order = dst_order; dst_order = to;
+    }
+
+    if (src_order != queue->order)
+        memcpy(queue->order, src_order, n * sizeof(uint16_t));
+}
+
+void RenderQueueExecute(RenderQueue *queue)
+{
+    int pass = -1;
+    for (int i = 0; i < queue->count; i++) {
+        int index = queue->order[i];
+        const RenderCommand *command = &queue->commands[index];
+
+        int command_pass = (int)(queue->keys[index] >> 60);
+        if (command_pass != pass) {
+            const PassState *state = &pass_states[command_pass];
+            if (pass < 0 || state->depth_test != pass_states[pass].depth_test) {
+                if (state->depth_test)
+                    glEnable(GL_DEPTH_TEST);
+                else
+                    glDisable(GL_DEPTH_TEST);
+            }
+            if (pass < 0 || state->depth_write != pass_states[pass].depth_write)
+                glDepthMask(state->depth_write);
+            pass = command_pass;
+        }
+
+        GLStateUseProgram(command->program);
+        if (command->texture) {
+            GLStateActiveTexture(GL_TEXTURE0);
+            GLStateBindTexture(command->texture_target ? command->texture_target : GL_TEXTURE_2D,
+                               command->texture);
+        }
+        if (command->multi_draw) {
+            MultiDrawSubmit(command->multi_draw);
+            continue;
+        }
+        GLStateBindVertexArray(command->vao);
+        if (command->model_location >= 0)
+            glUniformMatrix4fv(command->model_location, 1, GL_FALSE, &command->model[0][0]);
+        if (command->arrays) {
+            glDrawArrays(command->mode, command->first_index, command->count);
+            continue;
+        }
+        GLenum index_type = command->index_type ? command->index_type : GL_UNSIGNED_INT;
+        size_t index_size = index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+        glDrawElementsBaseVertex(command->mode, command->count, index_type,
+                                 (void *)(command->first_index * index_size), command->base_vertex);
+    }
+
+    // leave depth state the way the rest of the frame expects it
+    if (pass >= 0 && !pass_states[pass].depth_test)
+        glEnable(GL_DEPTH_TEST);
+    if (pass >= 0 && !pass_states[pass].depth_write)
+        glDepthMask(GL_TRUE);
+}
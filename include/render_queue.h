@@ -0,0 +1,54 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <cglm/cglm.h>
+#include "glad/glad.h"
+#include "multi_draw.h"
+
+// Draws are recorded with a 64-bit sort key and executed in key order, so
+// the most expensive state (pass, then program, texture, VAO) changes as
+// rarely as possible whatever order the frame submits them in.
+//
+//  63    60 59       48 47            32 31       20 19          0
+// [ pass  ][ program  ][    texture     ][   vao    ][   depth    ]
+#define RENDER_QUEUE_CAPACITY 1024
+
+typedef enum {
+    RENDER_PASS_BACKGROUND,
+    RENDER_PASS_OPAQUE,
+    RENDER_PASS_LINES,
+    RENDER_PASS_COUNT
+} RenderPass;
+
+typedef struct {
+    GLuint program;
+    GLenum texture_target;  // GL_TEXTURE_2D when left 0
+    GLuint texture;         // bound to unit 0, 0 for none
+    GLuint vao;
+    GLenum mode;
+    GLsizei count;
+    GLenum index_type;      // GL_UNSIGNED_INT when left 0
+    GLuint first_index;
+    GLint base_vertex;
+    bool arrays;            // glDrawArrays of count vertices from first_index, no index buffer
+    GLint model_location;   // -1 when the program has no model matrix
+    mat4 model;
+    MultiDraw *multi_draw;  // when set, submits this batch instead of one draw
+} RenderCommand;
+
+typedef struct {
+    RenderCommand commands[RENDER_QUEUE_CAPACITY];
+    uint64_t keys[RENDER_QUEUE_CAPACITY];
+    uint16_t order[RENDER_QUEUE_CAPACITY];     // command indices in key order
+    uint64_t scratch_keys[2][RENDER_QUEUE_CAPACITY];
+    uint16_t scratch_order[RENDER_QUEUE_CAPACITY];
+    int count;
+    float far_plane;        // depth is quantised over [0, far_plane]
+} RenderQueue;
+
+void RenderQueueInit(RenderQueue *queue, float far_plane);
+void RenderQueueReset(RenderQueue *queue);
+// copies the command; depth is the distance from the camera, nearer sorts first
+void RenderQueuePush(RenderQueue *queue, RenderPass pass, float depth, const RenderCommand *command);
+void RenderQueueSort(RenderQueue *queue);
+void RenderQueueExecute(RenderQueue *queue);
@@ -0,0 +1,155 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "shader_cache.h"
+#include "gl_caps.h"
+#include "arena.h"
+
+#define SHADER_CACHE_VERSION 1
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t length;
+    double compile_seconds;
+} CacheHeader;
+
+static ShaderCacheStats stats;
+
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t fnv1a(uint64_t hash, const char *text)
+{
+    if (!text)
+        text = "";
+    // the terminator goes in as well, so "ab" + "c" and "a" + "bc" differ
+    do {
+        hash ^= (unsigned char)*text;
+        hash *= 0x100000001B3ull;
+    } while (*text++);
+    return hash;
+}
+
+uint64_t ShaderCacheKey(const char *const *sources, int count)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    hash = fnv1a(hash, (const char *)glGetString(GL_VENDOR));
+    hash = fnv1a(hash, (const char *)glGetString(GL_RENDERER));
+    hash = fnv1a(hash, (const char *)glGetString(GL_VERSION));
+    for (int i = 0; i < count; i++)
+        hash = fnv1a(hash, sources[i]);
+    return hash;
+}
+
+static void cache_path(char *path, size_t size, uint64_t key)
+{
+    snprintf(path, size, SHADER_CACHE_DIR "/%016" PRIx64 ".bin", key);
+}
+
+bool ShaderCacheLoad(GLuint program, uint64_t key)
+{
+    if (!gl_caps.program_binary)
+        return false;
+
+    char path[64];
+    cache_path(path, sizeof(path), key);
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return false;
+
+    double start = now_seconds();
+    ArenaMarker mark = ArenaMark(&scratch_arena);
+    CacheHeader header;
+    bool loaded = false;
+    if (fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, "SPRG", 4) == 0
+        && header.version == SHADER_CACHE_VERSION && header.key == key && header.length > 0) {
+        void *binary = ArenaAlloc(&scratch_arena, header.length);
+        if (binary && fread(binary, 1, header.length, file) == header.length) {
+            glProgramBinary(program, header.format, binary, header.length);
+            GLint linked = GL_FALSE;
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+            loaded = linked == GL_TRUE;
+        }
+    }
+    fclose(file);
+    ArenaRelease(&scratch_arena, mark);
+
+    if (!loaded) {
+        printf("shader cache: %s is stale or corrupt, recompiling\n", path);
+        return false;
+    }
+    double elapsed = now_seconds() - start;
+    stats.hits++;
+    stats.load_seconds += elapsed;
+    stats.saved_seconds += header.compile_seconds - elapsed;
+    return true;
+}
+
+void ShaderCacheMarkRetrievable(GLuint program)
+{
+    if (gl_caps.program_binary)
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ShaderCacheStore(GLuint program, uint64_t key, double compile_seconds)
+{
+    stats.misses++;
+    if (!gl_caps.program_binary)
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    ArenaMarker mark = ArenaMark(&scratch_arena);
+    void *binary = ArenaAlloc(&scratch_arena, length);
+    CacheHeader header = {{'S', 'P', 'R', 'G'}, SHADER_CACHE_VERSION, key, 0, 0, compile_seconds};
+    GLsizei written = 0;
+    GLenum format = 0;
+    if (binary)
+        glGetProgramBinary(program, length, &written, &format, binary);
+    header.format = format;
+    header.length = written;
+
+    char path[64];
+    cache_path(path, sizeof(path), key);
+    mkdir(SHADER_CACHE_DIR, 0755);
+    FILE *file = written > 0 ? fopen(path, "wb") : NULL;
+    if (file) {
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+               && fwrite(binary, 1, written, file) == (size_t)written;
+        fclose(file);
+        if (!ok) {
+            fprintf(stderr, "shader cache: error writing %s\n", path);
+            remove(path);
+        }
+    }
+    ArenaRelease(&scratch_arena, mark);
+}
+
+const ShaderCacheStats *ShaderCacheGetStats(void)
+{
+    return &stats;
+}
+
+void ShaderCachePrintStats(void)
+{
+    if (!gl_caps.program_binary) {
+        printf("shader cache: program binaries not supported, %d programs compiled\n", stats.misses);
+        return;
+    }
+    printf("shader cache: %d restored in %.1f ms (saved ~%.1f ms), %d compiled\n",
+           stats.hits, stats.load_seconds * 1000.0, stats.saved_seconds * 1000.0, stats.misses);
+}
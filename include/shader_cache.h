@@ -0,0 +1,30 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "glad/glad.h"
+
+// Linked programs saved with glGetProgramBinary() and restored with
+// glProgramBinary() on the next launch. The key hashes the shader sources
+// together with the driver's vendor, renderer and version strings, and the
+// driver may still reject a binary (after an update, say), so a failed
+// load just means compiling as usual.
+#define SHADER_CACHE_DIR ".shader_cache"
+
+typedef struct {
+    int hits;
+    int misses;
+    double load_seconds;       // spent restoring binaries
+    double saved_seconds;      // compile time the restored binaries originally took, minus load time
+} ShaderCacheStats;
+
+uint64_t ShaderCacheKey(const char *const *sources, int count);
+
+// restores the program from the cache, true when it is linked and usable
+bool ShaderCacheLoad(GLuint program, uint64_t key);
+// call before glLinkProgram() on programs that will be stored
+void ShaderCacheMarkRetrievable(GLuint program);
+// saves a linked program, compile_seconds is what the cache saves next time
+void ShaderCacheStore(GLuint program, uint64_t key, double compile_seconds);
+
+const ShaderCacheStats *ShaderCacheGetStats(void);
+void ShaderCachePrintStats(void);
@@ -2,110 +2,268 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <time.h>
 
 #include "shader_s.h"
+#include "shader_cache.h"
+#include "frame_stats.h"
+#include "gl_state.h"
+#include "arena.h"
+#include "gl_caps.h"
 
 
-int ShaderInit(Shader *shader)
+static double now_seconds(void)
 {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
 
-    FILE *vShaderFile;
-    FILE *fShaderFile;
-    if (!(vShaderFile = fopen(shader->vertexPath, "r"))){
-        fprintf(stderr, "can't open %s\n", shader->vertexPath);
-        return 1;
+// whole file as a NUL-terminated string in the scratch arena
+static char *read_source(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "can't open %s\n", path);
+        return NULL;
     }
-    if (!(fShaderFile = fopen(shader->fragmentPath, "r"))){
-        fprintf(stderr, "can't open %s\n", shader->fragmentPath);
-        return 1;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+
+    char *buffer = ArenaAlloc(&scratch_arena, size + 1);
+    if (buffer == NULL) {
+        perror("error allocating");
+        fclose(file);
+        return NULL;
     }
-    
-    fseek(vShaderFile, 0, SEEK_END);
-    fseek(fShaderFile, 0, SEEK_END);
+    size_t bytesRead = fread(buffer, sizeof(char), size, file);
+    buffer[bytesRead] = '\0';
+    fclose(file);
+    return buffer;
+}
 
-    long vfileSize = ftell(vShaderFile);
-    long ffileSize = ftell(fShaderFile);
+static GLuint issue_stage(GLenum type, const char *source)
+{
+    GLuint stage = glCreateShader(type);
+    glShaderSource(stage, 1, &source, NULL);
+    glCompileShader(stage);
+    return stage;
+}
 
-    rewind(vShaderFile);
-    rewind(fShaderFile);
+static bool check_stage(GLuint stage, const char *name, const char *path)
+{
+    int success;
+    char infoLog[512];
+    glGetShaderiv(stage, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(stage, 512, NULL, infoLog);
+        printf("ERROR %s SHADER compilation failed (%s)\n", name, path);
+        printf("%s\n", infoLog);
+    }
+    return success;
+}
 
-    char *vbuffer = (char*) malloc((vfileSize + 1) * sizeof(char));
-    char *fbuffer = (char*) malloc((ffileSize + 1) * sizeof(char));
+void ShaderBatchInit(ShaderBatch *batch)
+{
+    batch->count = 0;
+    batch->compiled = 0;
+    batch->issue_seconds = 0.0;
+}
 
-    if (vbuffer == NULL){
-        perror("error allocating");
-        fclose(vShaderFile);
-        return 1;
+void ShaderBatchAdd(ShaderBatch *batch, Shader *shader)
+{
+    if (batch->count >= SHADER_BATCH_CAPACITY) {
+        fprintf(stderr, "shader batch full, %s not built\n", shader->vertexPath);
+        return;
     }
+    batch->shaders[batch->count++] = shader;
+}
 
-    if (fbuffer == NULL){
-        perror("error allocating");
-        fclose(fShaderFile);
-        return 1;
-    }
-    
-    size_t vbytesRead = fread(vbuffer, sizeof(char), vfileSize, vShaderFile);
-    size_t fbytesRead = fread(fbuffer, sizeof(char), ffileSize, fShaderFile);
-    vbuffer[vbytesRead] = '\0';
-    fbuffer[fbytesRead] = '\0';
-    const char *vShaderCode = vbuffer;
-    const char *fShaderCode = fbuffer;
-    fclose(vShaderFile);
-    fclose(fShaderFile);
-
-    unsigned int vertex;
-    unsigned int fragment;
-    int success;
-    char infoLog[512];
+static const char *feature_defines[SHADER_FEATURE_COUNT] = {
+    "HAS_SPECULAR_MAP",
+    "HAS_NORMAL_MAP",
+    "HAS_ATMOSPHERE",
+    "HAS_SHADOWS",
+    "HAS_LOG_DEPTH",
+};
 
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
+// The variant's #defines go right after the #version line, followed by a
+// #line directive so compiler messages still point at the file's lines.
+static const char *specialise(const char *source, unsigned int variant)
+{
+    if (!variant)
+        return source;
 
-    glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-        printf("ERROR VERTEX SHADER compilation failed\n");
-        printf("%s\n", infoLog);
+    char defines[256];
+    int length = 0;
+    for (int i = 0; i < SHADER_FEATURE_COUNT; i++) {
+        if (SHADER_VARIANT_FEATURES(variant) & (1u << i))
+            length += snprintf(defines + length, sizeof(defines) - length, "#define %s 1\n", feature_defines[i]);
     }
+    if (SHADER_VARIANT_LOD(variant) >= 0)
+        length += snprintf(defines + length, sizeof(defines) - length, "#define LOD_LEVEL %d\n",
+                           SHADER_VARIANT_LOD(variant));
 
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
+    const char *body = source;
+    int line = 1;
+    const char *version = strstr(source, "#version");
+    if (version) {
+        const char *end = strchr(version, '\n');
+        body = end ? end + 1 : version + strlen(version);
+        for (const char *p = source; p < body; p++)
+            line += *p == '\n';
+    }
 
-    glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-        printf("ERROR FRAGMENT SHADER compilation failed\n");
-        printf("%s\n", infoLog);
+    size_t head = body - source;
+    size_t size = head + length + 32 + strlen(body) + 1;
+    char *specialised = ArenaAlloc(&scratch_arena, size);
+    if (!specialised)
+        return source;
+    memcpy(specialised, source, head);
+    if (head && source[head - 1] != '\n')
+        specialised[head++] = '\n';
+    snprintf(specialised + head, size - head, "%s#line %d\n%s", defines, line, body);
+    return specialised;
+}
+
+void ShaderBatchCompile(ShaderBatch *batch)
+{
+    FrameStatsNoteActivity(FRAME_ACTIVITY_SHADER_COMPILE);
+    for (int i = 0; i < batch->count; i++) {
+        Shader *shader = batch->shaders[i];
+        batch->stages[i][0] = batch->stages[i][1] = 0;
+        shader->ID = 0;
+
+        // the driver copies the sources, they can go as soon as they are handed over
+        ArenaMarker mark = ArenaMark(&scratch_arena);
+        const char *sources[2] = {read_source(shader->vertexPath), read_source(shader->fragmentPath)};
+        if (!sources[0] || !sources[1]) {
+            ArenaRelease(&scratch_arena, mark);
+            continue;
+        }
+        sources[0] = specialise(sources[0], shader->variant);
+        sources[1] = specialise(sources[1], shader->variant);
+
+        batch->keys[i] = ShaderCacheKey(sources, 2);
+        shader->ID = glCreateProgram();
+        if (!ShaderCacheLoad(shader->ID, batch->keys[i])) {
+            double start = now_seconds();
+            GLuint vertex = issue_stage(GL_VERTEX_SHADER, sources[0]);
+            GLuint fragment = issue_stage(GL_FRAGMENT_SHADER, sources[1]);
+            glAttachShader(shader->ID, vertex);
+            glAttachShader(shader->ID, fragment);
+            ShaderCacheMarkRetrievable(shader->ID);
+            glLinkProgram(shader->ID);
+            batch->stages[i][0] = vertex;
+            batch->stages[i][1] = fragment;
+            batch->compiled++;
+            batch->issue_seconds += now_seconds() - start;
+        }
+        ArenaRelease(&scratch_arena, mark);
+    }
+}
+
+bool ShaderBatchPending(const ShaderBatch *batch)
+{
+    if (!gl_caps.parallel_shader_compile)
+        return false;
+    for (int i = 0; i < batch->count; i++) {
+        if (!batch->stages[i][0])
+            continue;
+        GLint done = GL_TRUE;
+        glGetProgramiv(batch->shaders[i]->ID, GL_COMPLETION_STATUS_KHR, &done);
+        if (!done)
+            return true;
     }
-    
-    shader->ID = glCreateProgram();
-    glAttachShader((shader->ID), vertex);
-    glAttachShader((shader->ID), fragment);
-    glLinkProgram((shader->ID));
+    return false;
+}
 
+int ShaderBatchFinish(ShaderBatch *batch)
+{
+    // blocks until the driver is done, which is the compile time left to wait for
+    double start = now_seconds();
+    int failures = 0;
+    bool linked[SHADER_BATCH_CAPACITY];
+    for (int i = 0; i < batch->count; i++) {
+        Shader *shader = batch->shaders[i];
+        linked[i] = shader->ID != 0;
+        if (!shader->ID || !batch->stages[i][0]) {
+            failures += !linked[i];
+            continue;
+        }
 
-    glGetShaderiv((shader->ID), GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog((shader->ID), 512, NULL, infoLog);
-        printf("ERROR SHADER compilation failed\n");
-        printf("%s\n", infoLog);
+        check_stage(batch->stages[i][0], "VERTEX", shader->vertexPath);
+        check_stage(batch->stages[i][1], "FRAGMENT", shader->fragmentPath);
+
+        int success;
+        char infoLog[512];
+        glGetProgramiv(shader->ID, GL_LINK_STATUS, &success);
+        if (!success) {
+            glGetProgramInfoLog(shader->ID, 512, NULL, infoLog);
+            printf("ERROR SHADER linking failed (%s, %s)\n", shader->vertexPath, shader->fragmentPath);
+            printf("%s\n", infoLog);
+            glDeleteProgram(shader->ID);
+            shader->ID = 0;
+            failures++;
+        }
+        linked[i] = success;
+
+        glDeleteShader(batch->stages[i][0]);
+        glDeleteShader(batch->stages[i][1]);
     }
 
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+    // the programs were built together, so each one is charged an equal share
+    double compile_seconds = batch->compiled
+        ? (batch->issue_seconds + now_seconds() - start) / batch->compiled : 0.0;
+    for (int i = 0; i < batch->count; i++) {
+        if (batch->stages[i][0] && linked[i])
+            ShaderCacheStore(batch->shaders[i]->ID, batch->keys[i], compile_seconds);
+        batch->stages[i][0] = batch->stages[i][1] = 0;
+    }
+    return failures;
+}
 
-    free(vbuffer);
-    free(fbuffer);
-    return 0;
+int ShaderInit(Shader *shader)
+{
+    ShaderBatch batch;
+    ShaderBatchInit(&batch);
+    ShaderBatchAdd(&batch, shader);
+    ShaderBatchCompile(&batch);
+    return ShaderBatchFinish(&batch);
 }
 
 
 
 void ShaderUse(Shader shader)
 {
-    glUseProgram((shader.ID));
+    GLStateUseProgram(shader.ID);
+}
+
+void ShaderReplaceProgram(Shader *shader, unsigned int ID)
+{
+    if (shader->ID)
+        glDeleteProgram(shader->ID);
+    shader->ID = ID;
+    shader->generation++;
+    shader->uniform_count = 0;
+    // the deleted program's name can come back for a new one, so the
+    // cached binding cannot be trusted either way
+    GLStateInvalidate();
+}
+
+GLint ShaderUniformLocation(Shader *shader, const char *name)
+{
+    for (int i = 0; i < shader->uniform_count; i++) {
+        if (shader->uniforms[i].name == name || strcmp(shader->uniforms[i].name, name) == 0)
+            return shader->uniforms[i].location;
+    }
+
+    GLint location = glGetUniformLocation(shader->ID, name);
+    if (shader->uniform_count < SHADER_MAX_UNIFORMS)
+        shader->uniforms[shader->uniform_count++] = (ShaderUniform) {name, location};
+    return location;
 }
 
 
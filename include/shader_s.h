@@ -1,15 +1,77 @@
 #pragma once
 #include <stdbool.h>
+#include <stdint.h>
+#include "glad/glad.h"
+
+#define SHADER_MAX_UNIFORMS 16
+
+// Variants of one source: feature bits and an optional LOD level become
+// #defines inserted after the #version line (HAS_SPECULAR_MAP, ...,
+// LOD_LEVEL n), so shaders can #ifdef away work a body does not need.
+// Variant 0 is the source as written.
+typedef enum {
+    SHADER_FEATURE_SPECULAR_MAP = 1 << 0,
+    SHADER_FEATURE_NORMAL_MAP   = 1 << 1,
+    SHADER_FEATURE_ATMOSPHERE   = 1 << 2,
+    SHADER_FEATURE_SHADOWS      = 1 << 3,
+    SHADER_FEATURE_LOG_DEPTH    = 1 << 4,   // see depth_buffer.h
+    SHADER_FEATURE_COUNT        = 5
+} ShaderFeature;
+
+#define SHADER_LOD_SHIFT 8
+#define SHADER_VARIANT(features, lod) ((features) | ((unsigned int)((lod) + 1) << SHADER_LOD_SHIFT))
+#define SHADER_VARIANT_FEATURES(variant) ((variant) & ((1u << SHADER_LOD_SHIFT) - 1))
+#define SHADER_VARIANT_LOD(variant) ((int)((variant) >> SHADER_LOD_SHIFT) - 1)   // -1 when unset
+
+typedef struct {
+    const char *name;
+    GLint location;
+} ShaderUniform;
 
 typedef struct {
     const char *vertexPath;
     const char *fragmentPath;
     unsigned int ID;
+    unsigned int generation;    // bumped whenever ID is replaced by a rebuilt program
+    unsigned int variant;       // SHADER_VARIANT() of the defines built into ID
+
+    // locations looked up so far, dropped when the program is replaced
+    int uniform_count;
+    ShaderUniform uniforms[SHADER_MAX_UNIFORMS];
 } Shader;
 
+#define SHADER_BATCH_CAPACITY 16
+
+// Builds several programs together. ShaderBatchCompile() issues every
+// compile and link without reading anything back, so the driver is never
+// made to finish one program before it sees the next; with
+// KHR_parallel_shader_compile it works on them on its own threads while
+// the caller loads other assets. ShaderBatchFinish() then checks statuses
+// and logs, and stores the new programs in the binary cache.
+typedef struct {
+    Shader *shaders[SHADER_BATCH_CAPACITY];
+    GLuint stages[SHADER_BATCH_CAPACITY][2];    // 0 for programs restored from the cache
+    uint64_t keys[SHADER_BATCH_CAPACITY];
+    int count;
+    int compiled;                               // programs that were not in the cache
+    double issue_seconds;                       // time spent issuing their compiles and links
+} ShaderBatch;
+
+void ShaderBatchInit(ShaderBatch *batch);
+void ShaderBatchAdd(ShaderBatch *batch, Shader *shader);
+void ShaderBatchCompile(ShaderBatch *batch);
+// true while the driver is still working, always false without the KHR extension
+bool ShaderBatchPending(const ShaderBatch *batch);
+// returns the number of programs that failed to build, their ID is left 0
+int ShaderBatchFinish(ShaderBatch *batch);
+
+// builds a single program, a batch of one
 int ShaderInit(Shader *shader);
 void ShaderUse(Shader shader);
+// deletes the current program and takes over the one in ID
+void ShaderReplaceProgram(Shader *shader, unsigned int ID);
+// cached glGetUniformLocation(), name must outlive the shader (a literal)
+GLint ShaderUniformLocation(Shader *shader, const char *name);
 void ShaderSetBool(Shader shader, const char name[], bool value);
 void ShaderSetInt(Shader shader, const char name[], int value);
 void ShaderSetFloat(Shader shader, const char name[], float value);
-
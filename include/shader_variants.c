@@ -0,0 +1,36 @@
+#include <stdio.h>
+
+#include "shader_variants.h"
+
+
+void ShaderVariantsInit(ShaderVariants *variants, const char *vertexPath, const char *fragmentPath,
+                        ShaderWatch *watch)
+{
+    variants->vertexPath = vertexPath;
+    variants->fragmentPath = fragmentPath;
+    variants->count = 0;
+    variants->watch = watch;
+}
+
+Shader *ShaderVariantsGet(ShaderVariants *variants, unsigned int variant, ShaderBatch *batch)
+{
+    for (int i = 0; i < variants->count; i++) {
+        if (variants->variants[i].variant == variant)
+            return &variants->variants[i];
+    }
+    if (variants->count >= SHADER_VARIANT_CAPACITY) {
+        fprintf(stderr, "%s: too many shader variants, 0x%x not built\n", variants->fragmentPath, variant);
+        return NULL;
+    }
+
+    Shader *shader = &variants->variants[variants->count++];
+    *shader = (Shader) {.vertexPath = variants->vertexPath, .fragmentPath = variants->fragmentPath,
+                        .variant = variant};
+    if (batch)
+        ShaderBatchAdd(batch, shader);
+    else
+        ShaderInit(shader);
+    if (variants->watch)
+        ShaderWatchAdd(variants->watch, shader);
+    return shader;
+}
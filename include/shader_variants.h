@@ -0,0 +1,23 @@
+#pragma once
+#include "shader_s.h"
+#include "shader_watch.h"
+
+// Programs built from one vertex/fragment pair, one per variant asked for.
+// Only requested variants are ever compiled; asking again returns the same
+// Shader, and the binary cache keeps them across launches.
+#define SHADER_VARIANT_CAPACITY 16
+
+typedef struct {
+    const char *vertexPath;
+    const char *fragmentPath;
+    Shader variants[SHADER_VARIANT_CAPACITY];
+    int count;
+    ShaderWatch *watch;     // new variants are registered for hot reload, may be NULL
+} ShaderVariants;
+
+void ShaderVariantsInit(ShaderVariants *variants, const char *vertexPath, const char *fragmentPath,
+                        ShaderWatch *watch);
+// The variant's Shader, built on first request: added to batch when one is
+// given (its ID is valid after ShaderBatchFinish()), compiled right away
+// otherwise. NULL when the table is full.
+Shader *ShaderVariantsGet(ShaderVariants *variants, unsigned int variant, ShaderBatch *batch);
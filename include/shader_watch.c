@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "shader_watch.h"
+
+
+int ShaderWatchInit(ShaderWatch *watch, const char *directory)
+{
+    watch->fd = -1;
+    watch->watch = -1;
+    watch->count = 0;
+    watch->building = false;
+
+#ifdef __linux__
+    watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch->fd < 0) {
+        perror("inotify_init1");
+        return 1;
+    }
+    // editors either rewrite the file in place or rename a new one over it
+    watch->watch = inotify_add_watch(watch->fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watch->watch < 0) {
+        perror(directory);
+        close(watch->fd);
+        watch->fd = -1;
+        return 1;
+    }
+    return 0;
+#else
+    (void)directory;
+    printf("shader hot reload needs inotify, not watching %s\n", directory);
+    return 1;
+#endif
+}
+
+void ShaderWatchAdd(ShaderWatch *watch, Shader *shader)
+{
+    if (watch->count >= SHADER_WATCH_CAPACITY) {
+        fprintf(stderr, "shader watch full, %s will not reload\n", shader->vertexPath);
+        return;
+    }
+    watch->changed[watch->count] = false;
+    watch->shaders[watch->count++] = shader;
+}
+
+static bool same_file(const char *path, const char *name)
+{
+    const char *slash = strrchr(path, '/');
+    return strcmp(slash ? slash + 1 : path, name) == 0;
+}
+
+static void drain_events(ShaderWatch *watch)
+{
+#ifdef __linux__
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t length;
+    while ((length = read(watch->fd, buffer, sizeof(buffer))) > 0) {
+        for (char *p = buffer; p < buffer + length; ) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + event->len;
+            if (!event->len)
+                continue;
+            for (int i = 0; i < watch->count; i++) {
+                const Shader *shader = watch->shaders[i];
+                if (same_file(shader->vertexPath, event->name) || same_file(shader->fragmentPath, event->name))
+                    watch->changed[i] = true;
+            }
+        }
+    }
+#else
+    (void)watch;
+#endif
+}
+
+static int finish_build(ShaderWatch *watch)
+{
+    ShaderBatchFinish(&watch->batch);
+
+    int replaced = 0;
+    for (int k = 0; k < watch->batch.count; k++) {
+        Shader *shader = watch->shaders[watch->staged_from[k]];
+        if (!watch->staging[k].ID) {
+            printf("shader reload: %s + %s failed, keeping the previous program\n",
+                   shader->vertexPath, shader->fragmentPath);
+            continue;
+        }
+        ShaderReplaceProgram(shader, watch->staging[k].ID);
+        printf("shader reload: %s + %s\n", shader->vertexPath, shader->fragmentPath);
+        replaced++;
+    }
+    watch->building = false;
+    return replaced;
+}
+
+int ShaderWatchPoll(ShaderWatch *watch)
+{
+    if (watch->fd < 0)
+        return 0;
+    drain_events(watch);
+
+    int replaced = 0;
+    if (watch->building && !ShaderBatchPending(&watch->batch))
+        replaced = finish_build(watch);
+
+    // anything that changed while a build was in flight goes in the next one
+    if (!watch->building) {
+        ShaderBatchInit(&watch->batch);
+        for (int i = 0; i < watch->count; i++) {
+            if (!watch->changed[i])
+                continue;
+            watch->changed[i] = false;
+            int k = watch->batch.count;
+            const Shader *live = watch->shaders[i];
+            watch->staging[k] = (Shader) {
+                .vertexPath = live->vertexPath, .fragmentPath = live->fragmentPath, .variant = live->variant,
+            };
+            watch->staged_from[k] = i;
+            ShaderBatchAdd(&watch->batch, &watch->staging[k]);
+        }
+        if (watch->batch.count) {
+            ShaderBatchCompile(&watch->batch);
+            watch->building = true;
+        }
+    }
+    return replaced;
+}
+
+void ShaderWatchClose(ShaderWatch *watch)
+{
+    if (watch->building)
+        finish_build(watch);
+    if (watch->fd >= 0)
+        close(watch->fd);
+    watch->fd = -1;
+}
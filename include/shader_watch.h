@@ -0,0 +1,30 @@
+#pragma once
+#include <stdbool.h>
+#include "shader_s.h"
+
+// Rebuilds shaders whose source files change on disk. An inotify watch on
+// the shader directory is drained once per frame; changed programs are
+// issued as one batch into staging copies and finished on a later poll,
+// once the driver reports them done, so the frame that saw the change is
+// not blocked on the compile. A program only replaces the live one if it
+// links, a broken edit keeps the previous program running.
+#define SHADER_WATCH_CAPACITY SHADER_BATCH_CAPACITY
+
+typedef struct {
+    int fd;             // inotify descriptor, -1 when watching is unavailable
+    int watch;
+    Shader *shaders[SHADER_WATCH_CAPACITY];
+    bool changed[SHADER_WATCH_CAPACITY];
+    int count;
+
+    bool building;
+    ShaderBatch batch;
+    Shader staging[SHADER_WATCH_CAPACITY];
+    int staged_from[SHADER_WATCH_CAPACITY];     // index into shaders of each staged program
+} ShaderWatch;
+
+int ShaderWatchInit(ShaderWatch *watch, const char *directory);
+void ShaderWatchAdd(ShaderWatch *watch, Shader *shader);
+// call once per frame, returns how many programs were replaced
+int ShaderWatchPoll(ShaderWatch *watch);
+void ShaderWatchClose(ShaderWatch *watch);
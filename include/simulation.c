@@ -0,0 +1,351 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "simulation.h"
+#include "arena.h"
+#include "mem_track.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define SIMULATION_COLUMNS 13
+#define SIMULATION_INITIAL_COST 1e-7    // until the first measurement
+
+
+typedef struct {
+    double step;
+    int body;
+} Candidate;
+
+// every per-body array with its element size, like KeplerOrbits' columns
+static void columns(Simulation *sim, void **out[SIMULATION_COLUMNS], size_t sizes[SIMULATION_COLUMNS])
+{
+    void **all[SIMULATION_COLUMNS] = {
+        (void **)&sim->parent, (void **)&sim->mode, (void **)&sim->mu, (void **)&sim->gm,
+        (void **)&sim->x, (void **)&sim->y, (void **)&sim->z,
+        (void **)&sim->vx, (void **)&sim->vy, (void **)&sim->vz,
+        (void **)&sim->ax, (void **)&sim->ay, (void **)&sim->az,
+    };
+    size_t all_sizes[SIMULATION_COLUMNS] = {
+        sizeof(int), sizeof(unsigned char), sizeof(double), sizeof(double),
+        sizeof(double), sizeof(double), sizeof(double),
+        sizeof(double), sizeof(double), sizeof(double),
+        sizeof(double), sizeof(double), sizeof(double),
+    };
+    for (int c = 0; c < SIMULATION_COLUMNS; c++) {
+        out[c] = all[c];
+        sizes[c] = all_sizes[c];
+    }
+}
+
+static int reserve(Simulation *sim, int capacity)
+{
+    if (capacity <= sim->capacity)
+        return 0;
+    void **column[SIMULATION_COLUMNS];
+    size_t size[SIMULATION_COLUMNS];
+    columns(sim, column, size);
+    for (int c = 0; c < SIMULATION_COLUMNS; c++) {
+        void *grown = MemTrackRealloc(MEM_SIMULATION, *column[c], capacity * size[c]);
+        if (!grown) {
+            perror("error allocating simulation");
+            return 1;
+        }
+        *column[c] = grown;
+    }
+    sim->capacity = capacity;
+    return 0;
+}
+
+int SimulationInit(Simulation *sim, int capacity, int parent_count, double sun_gm, double budget)
+{
+    *sim = (Simulation) {
+        .parent_count = parent_count, .sun_gm = sun_gm, .budget = budget,
+        .body_step_cost = SIMULATION_INITIAL_COST,
+    };
+    if (capacity < 1)
+        capacity = 16;
+    if (KeplerOrbitsInit(&sim->osculating, capacity))
+        return 1;
+    return reserve(sim, capacity);
+}
+
+void SimulationFree(Simulation *sim)
+{
+    void **column[SIMULATION_COLUMNS];
+    size_t size[SIMULATION_COLUMNS];
+    columns(sim, column, size);
+    for (int c = 0; c < SIMULATION_COLUMNS; c++) {
+        MemTrackFree(MEM_SIMULATION, *column[c]);
+        *column[c] = NULL;
+    }
+    KeplerOrbitsFree(&sim->osculating);
+    sim->count = sim->capacity = 0;
+}
+
+static double wrap_angle(double angle)
+{
+    return angle - 2 * M_PI * floor(angle / (2 * M_PI) + 0.5);
+}
+
+// position and velocity from the body's osculating elements
+static void state_from_elements(Simulation *sim, int k, double time)
+{
+    const KeplerOrbits *orbits = &sim->osculating;
+    double M = wrap_angle(orbits->mean_anomaly[k] + orbits->mean_motion[k] * time);
+    double E = KeplerSolve(M, orbits->eccentricity[k]);
+    double position[3], velocity[3];
+    KeplerOrbitPoint(orbits, k, E, position);
+    KeplerOrbitVelocity(orbits, k, E, velocity);
+    sim->x[k] = position[0];
+    sim->y[k] = position[1];
+    sim->z[k] = position[2];
+    sim->vx[k] = velocity[0];
+    sim->vy[k] = velocity[1];
+    sim->vz[k] = velocity[2];
+    sim->ax[k] = NAN;
+}
+
+int SimulationAdd(Simulation *sim, int parent, double parent_gm, double gm, const OrbitalElements *elements,
+                  double time)
+{
+    if (parent >= sim->parent_count) {
+        fprintf(stderr, "simulation: parent %d out of range\n", parent);
+        return -1;
+    }
+    if (sim->count == sim->capacity && reserve(sim, sim->capacity * 2))
+        return -1;
+    int k = KeplerOrbitsAdd(&sim->osculating, elements);
+    if (k < 0)
+        return -1;
+    sim->count++;
+    sim->parent[k] = parent;
+    sim->mode[k] = SIMULATION_INTEGRATED;
+    sim->mu[k] = parent_gm + gm;
+    sim->gm[k] = gm;
+    state_from_elements(sim, k, time);
+    return k;
+}
+
+static int to_analytic(Simulation *sim, int k, double time)
+{
+    double position[3] = {sim->x[k], sim->y[k], sim->z[k]};
+    double velocity[3] = {sim->vx[k], sim->vy[k], sim->vz[k]};
+    OrbitalElements elements;
+    if (KeplerElementsFromState(position, velocity, sim->mu[k], time, &elements)
+        || KeplerOrbitsSet(&sim->osculating, k, &elements))
+        return 1;
+    sim->mode[k] = SIMULATION_ANALYTIC;
+    return 0;
+}
+
+static int by_step_descending(const void *a, const void *b)
+{
+    double step_a = ((const Candidate *)a)->step, step_b = ((const Candidate *)b)->step;
+    return (step_a < step_b) - (step_a > step_b);
+}
+
+// picks the bodies to integrate over this step and the bin of each, and
+// switches modes to match; returns the finest bin in use, -1 when out of memory
+static int plan(Simulation *sim, double time, double step, int *bodies, int *bins, int *body_count)
+{
+    Candidate *candidates = ArenaAlloc(&frame_arena, sim->count * sizeof(Candidate));
+    if (!candidates)
+        return -1;
+    for (int k = 0; k < sim->count; k++) {
+        double r2 = sim->x[k] * sim->x[k] + sim->y[k] * sim->y[k] + sim->z[k] * sim->z[k];
+        candidates[k] = (Candidate) {sqrt(r2 * sqrt(r2) / sim->mu[k]) / SIMULATION_STEPS_PER_RADIAN, k};
+    }
+    qsort(candidates, sim->count, sizeof(Candidate), by_step_descending);
+
+    // cheapest first: a body in bin b costs 2^b force evaluations
+    int finest = 0, n = 0;
+    double evaluations = 0;
+    for (int c = 0; c < sim->count; c++) {
+        int k = candidates[c].body;
+        int bin = (int)ceil(log2(step / candidates[c].step));
+        if (bin < 0)
+            bin = 0;
+        double limit = sim->budget;
+        if (sim->mode[k] == SIMULATION_ANALYTIC)
+            limit *= SIMULATION_REINTEGRATE_MARGIN;
+        bool fits = bin <= SIMULATION_MAX_BIN
+                 && (evaluations + ldexp(1, bin)) * sim->body_step_cost <= limit;
+        if (!fits && sim->mode[k] == SIMULATION_INTEGRATED && !to_analytic(sim, k, time))
+            continue;
+        if (!fits && sim->mode[k] == SIMULATION_ANALYTIC)
+            continue;
+        // fits, or has no elements to fall back to
+        if (sim->mode[k] == SIMULATION_ANALYTIC) {
+            state_from_elements(sim, k, time);
+            sim->mode[k] = SIMULATION_INTEGRATED;
+        }
+        if (bin > SIMULATION_MAX_BIN)
+            bin = SIMULATION_MAX_BIN;
+        if (bin > finest)
+            finest = bin;
+        evaluations += ldexp(1, bin);
+        bodies[n] = k;
+        bins[n++] = bin;
+    }
+    *body_count = n;
+    return finest;
+}
+
+// the parent's pull, the Sun's on the body less its pull on the parent,
+// and the same difference for each massive sibling
+static void accelerate(const Simulation *sim, int k, const double (*parents)[3],
+                       const int *sources, int source_count, double out[3])
+{
+    double x = sim->x[k], y = sim->y[k], z = sim->z[k];
+    double r2 = x * x + y * y + z * z;
+    double g = -sim->mu[k] / (r2 * sqrt(r2));
+    out[0] = g * x;
+    out[1] = g * y;
+    out[2] = g * z;
+    for (int i = 0; i < source_count; i++) {
+        int j = sources[i];
+        if (j == k || sim->parent[j] != sim->parent[k])
+            continue;
+        double s[3] = {sim->x[j], sim->y[j], sim->z[j]};
+        double d[3] = {s[0] - x, s[1] - y, s[2] - z};
+        double d2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+        double s2 = s[0] * s[0] + s[1] * s[1] + s[2] * s[2];
+        double gd = sim->gm[j] / (d2 * sqrt(d2)), gs = sim->gm[j] / (s2 * sqrt(s2));
+        for (int c = 0; c < 3; c++)
+            out[c] += gd * d[c] - gs * s[c];
+    }
+    if (sim->parent[k] < 0)
+        return;
+    const double *p = parents[sim->parent[k]];
+    double b[3] = {p[0] + x, p[1] + y, p[2] + z};
+    double b2 = b[0] * b[0] + b[1] * b[1] + b[2] * b[2];
+    double p2 = p[0] * p[0] + p[1] * p[1] + p[2] * p[2];
+    double gb = -sim->sun_gm / (b2 * sqrt(b2)), gp = -sim->sun_gm / (p2 * sqrt(p2));
+    for (int c = 0; c < 3; c++)
+        out[c] += gb * b[c] - gp * p[c];
+}
+
+static void store_acceleration(Simulation *sim, int k, const double (*parents)[3], const int *sources,
+                               int source_count)
+{
+    double a[3];
+    accelerate(sim, k, parents, sources, source_count, a);
+    sim->ax[k] = a[0];
+    sim->ay[k] = a[1];
+    sim->az[k] = a[2];
+    sim->evaluations++;
+}
+
+static void kick(Simulation *sim, int k, double dt)
+{
+    sim->vx[k] += dt * sim->ax[k];
+    sim->vy[k] += dt * sim->ay[k];
+    sim->vz[k] += dt * sim->az[k];
+}
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void SimulationAdvance(Simulation *sim, double time, double step, SimulationParents parents, void *user)
+{
+    if (!sim->count || step == 0)
+        return;
+    ArenaMarker mark = ArenaMark(&frame_arena);
+    int *bodies = ArenaAlloc(&frame_arena, 3 * sim->count * sizeof(int));
+    double (*parent_positions)[3] = ArenaAlloc(&frame_arena, (sim->parent_count + 1) * sizeof(*parent_positions));
+    int n = 0;
+    int finest = bodies && parent_positions
+               ? plan(sim, time, step, bodies, bodies + sim->count, &n) : -1;
+    if (finest < 0) {
+        // the bodies keep their state and the next frame tries again
+        perror("error allocating simulation step");
+        ArenaRelease(&frame_arena, mark);
+        return;
+    }
+    int *bins = bodies + sim->count, *sources = bins + sim->count;
+    sim->substeps = n ? 1 << finest : 0;
+    sim->integrated = n;
+    sim->evaluations = 0;
+
+    if (n) {
+        int source_count = 0;
+        for (int i = 0; i < n; i++) {
+            if (sim->gm[bodies[i]] > 0)
+                sources[source_count++] = bodies[i];
+        }
+        int ticks = 1 << finest;
+        double h = step / ticks;
+        double start = now();
+
+        // Block steps: a body in bin b is kicked every 2^(finest - b) ticks,
+        // everything drifts every tick, so the bodies a kick needs are
+        // always where their own leapfrog puts them at that instant.
+        // every bin ends on the frame, so the closing kick's acceleration
+        // opens the next one; only bodies new to integration need one
+        bool sampled = false;
+        for (int i = 0; i < n; i++) {
+            if (!isnan(sim->ax[bodies[i]]))
+                continue;
+            if (!sampled)
+                parents(user, time, parent_positions);
+            sampled = true;
+            store_acceleration(sim, bodies[i], (const double (*)[3])parent_positions, sources, source_count);
+        }
+        for (int t = 0; t < ticks; t++) {
+            for (int i = 0; i < n; i++) {
+                int period = 1 << (finest - bins[i]);
+                if (t % period == 0)
+                    kick(sim, bodies[i], 0.5 * h * period);
+            }
+            for (int i = 0; i < n; i++) {
+                int k = bodies[i];
+                sim->x[k] += h * sim->vx[k];
+                sim->y[k] += h * sim->vy[k];
+                sim->z[k] += h * sim->vz[k];
+            }
+            // the finest bin ends a step every tick, so the parents are always needed
+            parents(user, time + (t + 1) * h, parent_positions);
+            for (int i = 0; i < n; i++) {
+                int period = 1 << (finest - bins[i]);
+                if ((t + 1) % period)
+                    continue;
+                store_acceleration(sim, bodies[i], (const double (*)[3])parent_positions, sources, source_count);
+                kick(sim, bodies[i], 0.5 * h * period);
+            }
+        }
+        // smoothed, one slow frame should not throw every body off
+        double measured = (now() - start) / sim->evaluations;
+        sim->body_step_cost = 0.9 * sim->body_step_cost + 0.1 * measured;
+    }
+
+    if (n < sim->count) {
+        KeplerOrbitsPropagate(&sim->osculating, time + step);
+        for (int k = 0; k < sim->count; k++) {
+            if (sim->mode[k] != SIMULATION_ANALYTIC)
+                continue;
+            sim->x[k] = sim->osculating.x[k];
+            sim->y[k] = sim->osculating.y[k];
+            sim->z[k] = sim->osculating.z[k];
+        }
+    }
+    ArenaRelease(&frame_arena, mark);
+}
+
+void SimulationPositions(const Simulation *sim, const double (*parent_positions)[3], double (*out)[3])
+{
+    for (int k = 0; k < sim->count; k++) {
+        const double *p = sim->parent[k] < 0 ? (const double[3]) {0, 0, 0} : parent_positions[sim->parent[k]];
+        out[k][0] = p[0] + sim->x[k];
+        out[k][1] = p[1] + sim->y[k];
+        out[k][2] = p[2] + sim->z[k];
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "kepler.h"
+
+// Bodies that are integrated rather than read off a fitted path: moons and
+// anything else whose orbit is perturbed. Each body moves about a parent,
+// the Sun or one of the caller's analytic bodies (the planets), and its
+// state is kept relative to that parent, so precision goes where the
+// motion is and the Sun's pull on a moon is a small tidal difference.
+// Bodies with mass pull on their siblings, the others about the same
+// parent. Steps are kick-drift-kick leapfrog, which keeps orbits from
+// drifting in energy however long the run.
+//
+// A body needs steps of a fraction of its local orbital time scale, which
+// spans orders of magnitude between an inner moon and an outer one. Each
+// body goes in a power-of-two bin: bin b takes 2^b steps over the frame,
+// the finest bin sets the tick, and every bin lines up again at the end
+// of the frame. A system of mixed periods then costs close to the sum of
+// what each body needs rather than the fastest body's rate for all.
+//
+// At high time warp the steps multiply regardless. Every advance plans
+// around the frame budget: bodies with the longest steps stay integrated
+// while the estimated cost fits, the rest are handed to Kepler propagation
+// from osculating elements taken at the moment they switch, and are
+// integrated again once the warp comes down. Cost per force evaluation is
+// measured, so the plan follows the machine it runs on.
+#define SIMULATION_STEPS_PER_RADIAN 16      // a circular orbit takes ~100 steps
+#define SIMULATION_MAX_BIN 12               // 4096 ticks a frame at most
+#define SIMULATION_REINTEGRATE_MARGIN 0.5   // analytic bodies return under this share of the budget
+
+typedef enum {
+    SIMULATION_INTEGRATED,
+    SIMULATION_ANALYTIC,
+} SimulationMode;
+
+// world positions of the parents at a time, the same shape as an EphemerisSampler
+typedef void (*SimulationParents)(void *user, double time, double (*positions)[3]);
+
+typedef struct {
+    int count;
+    int capacity;
+    int parent_count;
+
+    int *parent;                // index into the parent positions, -1 for the Sun
+    unsigned char *mode;        // SimulationMode
+    double *mu;                 // GM of the parent plus the body's own
+    double *gm;                 // the body's own, 0 for test particles
+    double *x, *y, *z;          // relative to the parent, world axes
+    double *vx, *vy, *vz;       // only current while integrated
+    double *ax, *ay, *az;       // at the end of the last advance, NAN when due
+    KeplerOrbits osculating;    // same indices, current while analytic
+
+    double sun_gm;
+    double budget;              // real seconds a frame may spend integrating
+    double body_step_cost;      // measured seconds per force evaluation
+    int substeps;               // ticks of the finest bin in the last advance
+    int integrated;             // bodies integrated in the last advance
+    int evaluations;            // force evaluations in the last advance
+} Simulation;
+
+int SimulationInit(Simulation *sim, int capacity, int parent_count, double sun_gm, double budget);
+void SimulationFree(Simulation *sim);
+// a body on the given orbit about parent at time; returns its index or -1
+int SimulationAdd(Simulation *sim, int parent, double parent_gm, double gm, const OrbitalElements *elements,
+                  double time);
+
+// moves every body from time to time + step
+void SimulationAdvance(Simulation *sim, double time, double step, SimulationParents parents, void *user);
+// world positions, given the parents' at the current time
+void SimulationPositions(const Simulation *sim, const double (*parent_positions)[3], double (*out)[3]);
@@ -0,0 +1,265 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+#include "mem_track.h"
+
+#define SNAPSHOT_COLUMNS 17
+
+
+// every saved column, body state first and then the osculating elements
+static void columns(const Simulation *sim, void *out[SNAPSHOT_COLUMNS], size_t sizes[SNAPSHOT_COLUMNS])
+{
+    const KeplerOrbits *o = &sim->osculating;
+    void *all[SNAPSHOT_COLUMNS] = {
+        sim->parent, sim->mode, sim->mu, sim->gm,
+        sim->x, sim->y, sim->z, sim->vx, sim->vy, sim->vz,
+        o->semi_major_axis, o->eccentricity, o->inclination, o->ascending_node,
+        o->argument_periapsis, o->mean_anomaly, o->mean_motion,
+    };
+    for (int c = 0; c < SNAPSHOT_COLUMNS; c++) {
+        out[c] = all[c];
+        sizes[c] = c == 0 ? sizeof(int) : c == 1 ? sizeof(unsigned char) : sizeof(double);
+    }
+}
+
+static size_t size_for(int body_count)
+{
+    return sizeof(SnapshotHeader) + (size_t)body_count * (sizeof(int) + sizeof(unsigned char)
+                                                          + 15 * sizeof(double));
+}
+
+size_t SnapshotSize(const Simulation *sim)
+{
+    return size_for(sim->count);
+}
+
+void SnapshotWrite(const Simulation *sim, double time, uint32_t state, void *out)
+{
+    SnapshotHeader header = {
+        {'S', 'S', 'N', 'P'}, SNAPSHOT_VERSION, sim->count, sim->parent_count, state, 0, time,
+    };
+    unsigned char *cursor = out;
+    memcpy(cursor, &header, sizeof(header));
+    cursor += sizeof(header);
+    void *column[SNAPSHOT_COLUMNS];
+    size_t size[SNAPSHOT_COLUMNS];
+    columns(sim, column, size);
+    for (int c = 0; c < SNAPSHOT_COLUMNS; c++) {
+        memcpy(cursor, column[c], sim->count * size[c]);
+        cursor += sim->count * size[c];
+    }
+}
+
+int SnapshotRead(Simulation *sim, const void *data, size_t size, double *time, uint32_t *state)
+{
+    SnapshotHeader header;
+    if (size < sizeof(header))
+        return 1;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, "SSNP", 4) != 0 || header.version != SNAPSHOT_VERSION
+        || (int)header.parent_count != sim->parent_count || (int)header.body_count != sim->count
+        || size != size_for(header.body_count)) {
+        fprintf(stderr, "snapshot: not a snapshot of this simulation\n");
+        return 1;
+    }
+    // parents and modes index into the live tables and the orbits must be
+    // ellipses, so all of it is checked before anything is replaced
+    const unsigned char *cursor = (const unsigned char *)data + sizeof(header);
+    const unsigned char *modes = cursor + sim->count * sizeof(int);
+    const unsigned char *axes = modes + sim->count * (sizeof(unsigned char) + 8 * sizeof(double));
+    const unsigned char *eccentricities = axes + sim->count * sizeof(double);
+    for (int k = 0; k < sim->count; k++) {
+        int parent;
+        double a, e;
+        memcpy(&parent, cursor + k * sizeof(int), sizeof(int));
+        memcpy(&a, axes + k * sizeof(double), sizeof(double));
+        memcpy(&e, eccentricities + k * sizeof(double), sizeof(double));
+        if (parent < -1 || parent >= sim->parent_count
+            || (modes[k] != SIMULATION_INTEGRATED && modes[k] != SIMULATION_ANALYTIC)
+            || !(a > 0) || !(e >= 0 && e <= KEPLER_MAX_ECCENTRICITY)) {
+            fprintf(stderr, "snapshot: body %d is malformed\n", k);
+            return 1;
+        }
+    }
+
+    void *column[SNAPSHOT_COLUMNS];
+    size_t column_size[SNAPSHOT_COLUMNS];
+    columns(sim, column, column_size);
+    for (int c = 0; c < SNAPSHOT_COLUMNS; c++) {
+        memcpy(column[c], cursor, sim->count * column_size[c]);
+        cursor += sim->count * column_size[c];
+    }
+    // the orbit axes are derived, not saved
+    const KeplerOrbits *o = &sim->osculating;
+    for (int k = 0; k < sim->count; k++) {
+        OrbitalElements elements = {
+            o->semi_major_axis[k], o->eccentricity[k], o->inclination[k], o->ascending_node[k],
+            o->argument_periapsis[k], o->mean_anomaly[k], o->mean_motion[k],
+        };
+        KeplerOrbitsSet(&sim->osculating, k, &elements);
+        sim->ax[k] = NAN;
+    }
+    *time = header.time;
+    if (state)
+        *state = header.state;
+    return 0;
+}
+
+int SnapshotSave(const char *path, const Simulation *sim, double time, uint32_t state)
+{
+    size_t size = SnapshotSize(sim);
+    void *data = MemTrackAlloc(MEM_SIMULATION, size);
+    if (!data) {
+        perror("error allocating snapshot");
+        return 1;
+    }
+    SnapshotWrite(sim, time, state, data);
+
+    // written aside and renamed over like the ephemeris, the parent is ours to create
+    char tmp_path[256];
+    snprintf(tmp_path, sizeof(tmp_path), "%s", path);
+    char *slash = strrchr(tmp_path, '/');
+    if (slash) {
+        *slash = '\0';
+        mkdir(tmp_path, 0755);
+    }
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *file = fopen(tmp_path, "wb");
+    int ok = file && fwrite(data, size, 1, file) == 1;
+    if (file)
+        ok = fclose(file) == 0 && ok;
+    MemTrackFree(MEM_SIMULATION, data);
+    if (!ok || rename(tmp_path, path)) {
+        fprintf(stderr, "snapshot: error writing %s\n", path);
+        remove(tmp_path);
+        return 1;
+    }
+    return 0;
+}
+
+int SnapshotLoad(const char *path, Simulation *sim, double *time, uint32_t *state)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return 1;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    void *data = size > 0 ? MemTrackAlloc(MEM_SIMULATION, size) : NULL;
+    int failed = !data || fread(data, size, 1, file) != 1;
+    fclose(file);
+    if (!failed)
+        failed = SnapshotRead(sim, data, size, time, state);
+    else
+        fprintf(stderr, "snapshot: error reading %s\n", path);
+    MemTrackFree(MEM_SIMULATION, data);
+    return failed;
+}
+
+int RecordingInit(Recording *recording, const Simulation *sim, int capacity, double interval)
+{
+    *recording = (Recording) {.interval = interval, .capacity = capacity};
+    recording->snapshots = MemTrackAlloc(MEM_SIMULATION, capacity * sizeof(void *));
+    recording->sizes = MemTrackAlloc(MEM_SIMULATION, capacity * sizeof(size_t));
+    recording->times = MemTrackAlloc(MEM_SIMULATION, capacity * sizeof(double));
+    if (!recording->snapshots || !recording->sizes || !recording->times) {
+        perror("error allocating recording");
+        RecordingFree(recording);
+        return 1;
+    }
+    for (int i = 0; i < capacity; i++)
+        recording->snapshots[i] = NULL;
+    // every slot up front, so the frame loop never allocates
+    size_t size = SnapshotSize(sim);
+    for (int i = 0; i < capacity; i++) {
+        recording->snapshots[i] = MemTrackAlloc(MEM_SIMULATION, size);
+        recording->sizes[i] = size;
+        if (!recording->snapshots[i]) {
+            perror("error allocating snapshot");
+            RecordingFree(recording);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void RecordingFree(Recording *recording)
+{
+    if (recording->snapshots) {
+        for (int i = 0; i < recording->capacity; i++)
+            MemTrackFree(MEM_SIMULATION, recording->snapshots[i]);
+    }
+    MemTrackFree(MEM_SIMULATION, recording->snapshots);
+    MemTrackFree(MEM_SIMULATION, recording->sizes);
+    MemTrackFree(MEM_SIMULATION, recording->times);
+    *recording = (Recording) {0};
+}
+
+static int slot(const Recording *recording, int i)
+{
+    return (recording->first + i) % recording->capacity;
+}
+
+void RecordingUpdate(Recording *recording, const Simulation *sim, double time, uint32_t state)
+{
+    if (!recording->capacity)
+        return;
+    if (recording->count) {
+        double newest = recording->times[slot(recording, recording->count - 1)];
+        if (time < newest + recording->interval)
+            return;
+    }
+    // once full the oldest slot is reused
+    bool full = recording->count == recording->capacity;
+    int s = full ? recording->first : slot(recording, recording->count);
+    // the slots were sized for the bodies the recording started with
+    if (recording->sizes[s] != SnapshotSize(sim))
+        return;
+    if (full)
+        recording->first = slot(recording, 1);
+    else
+        recording->count++;
+    SnapshotWrite(sim, time, state, recording->snapshots[s]);
+    recording->times[s] = time;
+}
+
+void RecordingTruncate(Recording *recording, double time)
+{
+    while (recording->count && recording->times[slot(recording, recording->count - 1)] > time)
+        recording->count--;
+}
+
+int RecordingSeek(Recording *recording, Simulation *sim, double target, SimulationParents parents, void *user,
+                  uint32_t *state)
+{
+    int i = recording->count - 1;
+    while (i >= 0 && recording->times[slot(recording, i)] > target)
+        i--;
+    if (i < 0)
+        return 1;
+    int s = slot(recording, i);
+    double time;
+    if (SnapshotRead(sim, recording->snapshots[s], recording->sizes[s], &time, state))
+        return 1;
+    // what comes after is history that is about to be rewritten
+    RecordingTruncate(recording, time);
+
+    // fixed chunks and no budget, so the result depends only on the
+    // snapshot and the target
+    double budget = sim->budget;
+    double chunk = recording->interval / RECORDING_REPLAY_CHUNKS;
+    sim->budget = INFINITY;
+    while (time < target) {
+        double step = target - time < chunk ? target - time : chunk;
+        SimulationAdvance(sim, time, step, parents, user);
+        time += step;
+    }
+    sim->budget = budget;
+    return 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "simulation.h"
+
+// The whole simulation state at one instant: time, the caller's state
+// bits and every body column, packed column after column behind a small
+// header. Restoring is a handful of copies, so a snapshot can be taken
+// and loaded mid-frame. Planet positions are analytic in time and need
+// no saving; accelerations and the cost estimate are recomputed.
+//
+// A recording keeps a ring of snapshots a fixed simulated interval apart.
+// Seeking loads the newest snapshot at or before the target and steps
+// forward in fixed chunks with no frame budget, so the same target always
+// lands on the same state however the original run was framed. Its slots
+// are allocated up front for the simulation's bodies, which are fixed from
+// then on, so taking a snapshot allocates nothing.
+#define SNAPSHOT_VERSION 1
+#define RECORDING_REPLAY_CHUNKS 64      // steps per recording interval when replaying
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t body_count;
+    uint32_t parent_count;
+    uint32_t state;         // the application's state bits
+    uint32_t reserved;
+    double time;
+} SnapshotHeader;
+
+size_t SnapshotSize(const Simulation *sim);
+// packs the state into out, which holds SnapshotSize() bytes
+void SnapshotWrite(const Simulation *sim, double time, uint32_t state, void *out);
+// replaces the simulation's body state with the snapshot's, 0 on success;
+// a snapshot of a different set of bodies is refused and changes nothing
+int SnapshotRead(Simulation *sim, const void *data, size_t size, double *time, uint32_t *state);
+
+int SnapshotSave(const char *path, const Simulation *sim, double time, uint32_t state);
+int SnapshotLoad(const char *path, Simulation *sim, double *time, uint32_t *state);
+
+typedef struct {
+    double interval;        // simulated seconds between snapshots
+    int capacity;
+    int count;
+    int first;              // oldest snapshot in the ring
+    void **snapshots;
+    size_t *sizes;
+    double *times;
+} Recording;
+
+int RecordingInit(Recording *recording, const Simulation *sim, int capacity, double interval);
+void RecordingFree(Recording *recording);
+// takes a snapshot when time is an interval past the newest, the oldest
+// goes once the ring is full
+void RecordingUpdate(Recording *recording, const Simulation *sim, double time, uint32_t state);
+// forgets the snapshots taken after time
+void RecordingTruncate(Recording *recording, double time);
+// puts the simulation at target from the nearest earlier snapshot and
+// drops the snapshots after it; nonzero if target predates the recording.
+// state, which may be NULL, gets the bits saved with that snapshot
+int RecordingSeek(Recording *recording, Simulation *sim, double target, SimulationParents parents, void *user,
+                  uint32_t *state);
@@ -1,2 +1,10 @@
+#include "arena.h"
+
+// decoded images only live until they are uploaded, so stb_image works out
+// of the scratch arena; loaders mark it before stbi_load and release after
+#define STBI_MALLOC(size) ArenaAlloc(&scratch_arena, size)
+#define STBI_REALLOC_SIZED(ptr, old_size, new_size) ArenaRealloc(&scratch_arena, ptr, old_size, new_size)
+#define STBI_FREE(ptr) ArenaFree(&scratch_arena, ptr)
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -0,0 +1,27 @@
+#include <math.h>
+#include <stdio.h>
+
+#include "time_warp.h"
+
+
+static double clamp_rate(double rate)
+{
+    return rate < TIME_WARP_MIN ? TIME_WARP_MIN : rate > TIME_WARP_MAX ? TIME_WARP_MAX : rate;
+}
+
+void TimeWarpInit(TimeWarp *warp, double rate)
+{
+    warp->rate = clamp_rate(rate);
+}
+
+void TimeWarpChange(TimeWarp *warp, int steps)
+{
+    warp->rate = clamp_rate(warp->rate * pow(10, steps));
+    printf("time warp: %gx\n", warp->rate);
+}
+
+double TimeWarpStep(const TimeWarp *warp, double frame_time)
+{
+    double real = frame_time < TIME_WARP_MAX_FRAME ? frame_time : TIME_WARP_MAX_FRAME;
+    return real * warp->rate;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+// How much simulated time one real second covers, stepped by powers of ten
+// from real time to TIME_WARP_MAX. A long frame (a hitch, the debugger)
+// is clamped rather than replayed, so one slow frame cannot ask the
+// simulation for a burst of work that makes the next one slow too.
+#define TIME_WARP_MIN 1.0
+#define TIME_WARP_MAX 1.0e7
+#define TIME_WARP_MAX_FRAME 0.1     // real seconds a single frame may advance
+
+typedef struct {
+    double rate;                    // simulated seconds per real second
+} TimeWarp;
+
+void TimeWarpInit(TimeWarp *warp, double rate);
+// multiplies the rate by 10^steps, clamped to the range above
+void TimeWarpChange(TimeWarp *warp, int steps);
+// simulated seconds for a frame that took frame_time real seconds
+double TimeWarpStep(const TimeWarp *warp, double frame_time);
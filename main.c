@@ -6,20 +6,74 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "include/shader_s.h"
+#include "include/shader_cache.h"
+#include "include/shader_watch.h"
+#include "include/shader_variants.h"
 #include "include/stb_image.h"
 #include "include/camera.h"
+#include "include/frame_stats.h"
+#include "include/gl_state.h"
+#include "include/render_queue.h"
+#include "include/gl_caps.h"
+#include "include/mesh.h"
+#include "include/multi_draw.h"
+#include "include/orbit_lines.h"
+#include "include/arena.h"
+#include "include/mem_track.h"
+#include "include/kepler.h"
+#include "include/ephemeris.h"
+#include "include/depth_buffer.h"
+#include "include/simulation.h"
+#include "include/time_warp.h"
+#include "include/snapshot.h"
+#include "include/catalogue.h"
+#include "include/belt.h"
 
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+// sphere meshes of increasing detail, picked per body by on-screen size
+#define SPHERE_LOD_COUNT 4
+// planet program variants, each drawing a range of sphere LODs; the far
+// one is built with a low LOD_LEVEL and skips the specular term
+#define PLANET_SHADER_TIERS 2
+#define PLANET_SHADER_TIER(lod) ((lod) * PLANET_SHADER_TIERS / SPHERE_LOD_COUNT)
+// planet positions for the first ten years come from a fitted ephemeris,
+// regenerated whenever the orbital elements change; eight day segments
+// are a tenth of Mercury's period and fit to a few centimetres
+#define PLANET_EPHEMERIS_PATH ".ephemeris/planets.bin"
+#define PLANET_EPHEMERIS_SPAN (10 * 365.25 * 86400.0)
+#define PLANET_EPHEMERIS_SEGMENT (8 * 86400.0)
+#define PLANET_EPHEMERIS_COEFFICIENTS 12
+
+// true scale, one world unit is a thousand kilometres: Earth's radius is
+// 6.4 units and Neptune orbits 4.5 million units out. Body and camera
+// positions are double, everything drawn is made camera-relative first.
+#define KM_PER_UNIT 1000.0
+#define UNITS_PER_AU (149597870.7 / KM_PER_UNIT)
+#define SUN_RADIUS (696000.0 / KM_PER_UNIT)
+#define SUN_GM (1.32712440018e11 / (KM_PER_UNIT * KM_PER_UNIT * KM_PER_UNIT))  // units^3 / s^2
+#define BODY_CATALOGUE "resources/bodies.txt"
+#define BODY_CATALOGUE_BINARY ".catalogue/bodies.bin"     // converted on first run, mapped after
+// starting time warp, and the real time per frame the integrated bodies
+// may take before the fastest of them switch to analytic orbits
+#define TIME_WARP_START 1000.0
+#define SIMULATION_BUDGET 0.002
+// a snapshot every simulated day, twenty years of them, for scrubbing
+// back and forth with '[' and ']'; F5 and F9 save and load one to disk
+#define RECORDING_INTERVAL 86400.0
+#define RECORDING_CAPACITY 7305
+#define SCRUB_STEP (30 * 86400.0)
+#define SNAPSHOT_PATH ".snapshots/quick.bin"
+// belt particles drawn on top of the catalogue's small bodies, which are brighter
+#define BELT_SEED 0x5EEDB017u
+#define BELT_CATALOGUE_BRIGHTNESS 1.0f
+// a metre to past Neptune in one depth pass, see depth_buffer.h
+#define NEAR_PLANE 0.001f
+#define FAR_PLANE 1.0e7f
 
-typedef struct {
-    float position[3];
-    float normal[3];
-    float texCoord[2];
-} Vertex;
 
 typedef struct {
     vec3 ambient;
@@ -37,11 +91,16 @@ struct PlanetData {
     unsigned char diffuse;
     unsigned char specular;
     float shininess;
-    vec3 orbit_position;
+    int body;           // index in the catalogue
+    int orbit;          // index in planet_orbits, or in moons when simulated
+    bool simulated;
+    double position[3]; // world, updated every frame
     float rotation_speed;
-	float orbital_speed;
 	float size;
-} planets[9];
+};
+// every body drawn as a sphere, in catalogue order
+struct PlanetData *planets;
+int planet_count;
 
 
 // used to handle certain states in the app for now:
@@ -56,24 +115,63 @@ float max(float a, float b);
 void processInput(GLFWwindow *window);
 void mouse_callback(GLFWwindow *window, double xpos, double ypos);
 unsigned int loadTexture(char const * path);
-void planets_setup();
+unsigned int loadTextureArray(char const **paths, int count);
+int select_sphere_lod(float size, float distance);
+int planets_setup();
+void update_body_positions();
+void planets_ephemeris_setup();
+void sample_planet_orbits(void *orbits, double time, double (*positions)[3]);
+void sample_planet_positions(void *user, double time, double (*positions)[3]);
+float camera_travel_speed();
+void bind_sampler_units(ShaderVariants *planet, Shader *sun, Shader *background);
 void keyboard_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
-GLuint create_sphere_vao_ebo(float radius, int slices, int stacks, int *index_count_out);
-void generate_sphere_indexed(
-float radius, int slices, int stacks,
-Vertex **vertices_out, int *vertex_count_out,
-GLuint **indices_out, int *index_count_out);
-unsigned int create_circle(float r, int s, int *index);
 
 
 int WINDOWWIDTH = 1280 * 2;
 int WINDOWHEIGHT = 720 * 2;
 
 // time related variables
-float deltaTime = 0.0;
-float lastFrame = 0.0;
-float animation_time = 0.0;
+double deltaTime = 0.0;
+double lastFrame = 0.0;
+double simulation_time = 0.0;  // seconds since the J2000 epoch of the orbital elements
 float rotation_time = 0.0;
+FrameStats frame_stats;
+RenderQueue render_queue;
+
+MeshPool mesh_pool;
+MeshRegistry mesh_registry;
+MultiDraw planet_batches[PLANET_SHADER_TIERS];
+// max distance between a unit sphere and its LOD mesh, the errors of the
+// 8x8, 16x16, 32x32 and 64x64 UV spheres these LODs started out as
+float sphere_lod_errors[SPHERE_LOD_COUNT] = {0.095f, 0.024f, 0.006f, 0.0015f};
+SphereGenerator sphere_generator = SPHERE_ICOSPHERE;
+Mesh sphere_lods[SPHERE_LOD_COUNT];
+OrbitLines orbit_lines;
+KeplerOrbits planet_orbits;
+Ephemeris planet_ephemeris;
+Simulation moons;
+Catalogue catalogue;
+Belt belt;
+// Kirkwood gaps cleared by the 3:1, 5:2, 7:3 and 2:1 resonances with Jupiter
+static const double kirkwood_gaps[] = {2.502 * UNITS_PER_AU, 2.825 * UNITS_PER_AU, 2.958 * UNITS_PER_AU,
+                                       3.279 * UNITS_PER_AU};
+static const BeltPopulation belt_populations[] = {
+	// main belt
+	{.count = 300000, .inner = 2.1 * UNITS_PER_AU, .outer = 3.3 * UNITS_PER_AU,
+	 .eccentricity = 0.3, .inclination = 0.12, .brightness = 0.55f,
+	 .gaps = kirkwood_gaps, .gap_count = 4, .gap_half_width = 0.015 * UNITS_PER_AU},
+	// classical Kuiper belt, then the plutinos in 3:2 resonance with Neptune
+	{.count = 200000, .inner = 42.0 * UNITS_PER_AU, .outer = 48.0 * UNITS_PER_AU,
+	 .eccentricity = 0.15, .inclination = 0.06, .brightness = 0.35f},
+	{.count = 50000, .inner = 39.2 * UNITS_PER_AU, .outer = 39.6 * UNITS_PER_AU,
+	 .eccentricity = 0.35, .inclination = 0.2, .brightness = 0.35f},
+};
+TimeWarp time_warp;
+Recording recording;
+DepthBuffer depth_buffer;
+ShaderWatch shader_watch;
+ShaderVariants planet_variants;
+unsigned int PlanetTextures;
 
 Camera camera;
 float yaw = -117.0;
@@ -87,7 +185,16 @@ vec3 result;
 vec3 temp;
 
 int main() {
-    Camera_init(&camera, (vec3) {12.146158, 7.960372, 28.563208}, (vec3) {0, 1, 0}, yaw, pitch);
+    // budgets only warn, they are sized a little above what a normal run uses
+    MemTrackSetBudget(MEM_TEXTURES, MEM_GPU, 256u << 20);
+    MemTrackSetBudget(MEM_MESHES, MEM_CPU, 4u << 20);
+    MemTrackSetBudget(MEM_MESHES, MEM_GPU, 2u << 20);
+    MemTrackSetBudget(MEM_ORBITS, MEM_GPU, 1u << 20);
+    MemTrackSetBudget(MEM_SIMULATION, MEM_CPU, 16u << 20);
+    MemTrackSetBudget(MEM_TRANSIENT, MEM_CPU, 256u << 20);   // the 8k sky map spills ~190 MiB while decoding
+    ArenaInit(&frame_arena, "frame", FRAME_ARENA_SIZE);
+    ArenaInit(&scratch_arena, "scratch", SCRATCH_ARENA_SIZE);
+    Camera_init(&camera, (double[3]) {0, 0, 0}, (vec3) {0, 1, 0}, yaw, pitch);
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -104,29 +211,54 @@ int main() {
         printf("unable to initialize glad\n");
         glfwTerminate();
     }
+    GLCapsInit((GLADloadproc)glfwGetProcAddress);
+    int framebuffer_width, framebuffer_height;
+    glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
+    DepthBufferInit(&depth_buffer, framebuffer_width, framebuffer_height, NEAR_PLANE, FAR_PLANE);
+    // every program that writes depth is built for the depth mapping in use
+    unsigned int depth_features = DepthBufferShaderFeatures(&depth_buffer);
+    float log_depth_scale = DepthBufferLogScale(&depth_buffer);
 
     glEnable(GL_DEPTH_TEST);
 		glEnable(GL_LINE_SMOOTH);
 		glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
-    vec3 lightPosition = {0.f, 0.0f, 0.0f};
-
-    Shader PlanetShader = {"shaders/planet_vertex.glsl", "shaders/planet_fragment.glsl", 0};
-    Shader SunShader = {"shaders/sun_vertex.glsl", "shaders/sun_fragment.glsl", 0};
-    Shader OrbitShader = {"shaders/line_vert.glsl", "shaders/line_frag.glsl", 0};
-    Shader BackgroundShader = {"shaders/background_vert.glsl", "shaders/background_frag.glsl", 0};
-    ShaderInit(&PlanetShader);
-    ShaderInit(&SunShader);
-    ShaderInit(&OrbitShader);
-    ShaderInit(&BackgroundShader);
+    double sun_position[3] = {0, 0, 0};
+
+    Shader SunShader = {"shaders/sun_vertex.glsl", "shaders/sun_fragment.glsl", 0, .variant = depth_features};
+    Shader OrbitShader = {"shaders/line_vert.glsl", "shaders/line_frag.glsl", 0, .variant = depth_features};
+    Shader BackgroundShader = {.vertexPath = "shaders/background_vert.glsl",
+                               .fragmentPath = "shaders/background_frag.glsl"};
+    Shader BeltShader = {"shaders/belt_vert.glsl", "shaders/belt_frag.glsl", 0, .variant = depth_features};
+    ShaderWatchInit(&shader_watch, "shaders");
+    ShaderWatchAdd(&shader_watch, &SunShader);
+    ShaderWatchAdd(&shader_watch, &OrbitShader);
+    ShaderWatchAdd(&shader_watch, &BackgroundShader);
+    ShaderWatchAdd(&shader_watch, &BeltShader);
+
+    // the driver compiles while the textures and meshes below load
+    ShaderBatch shader_batch;
+    ShaderBatchInit(&shader_batch);
+    ShaderVariantsInit(&planet_variants, "shaders/planet_vertex.glsl", "shaders/planet_fragment.glsl",
+                       &shader_watch);
+    Shader *planet_shaders[PLANET_SHADER_TIERS];
+    for (int t = 0; t < PLANET_SHADER_TIERS; t++) {
+        int finest_lod = (t + 1) * SPHERE_LOD_COUNT / PLANET_SHADER_TIERS - 1;
+        planet_shaders[t] = ShaderVariantsGet(&planet_variants, SHADER_VARIANT(depth_features, finest_lod),
+                                              &shader_batch);
+    }
+    ShaderBatchAdd(&shader_batch, &SunShader);
+    ShaderBatchAdd(&shader_batch, &OrbitShader);
+    ShaderBatchAdd(&shader_batch, &BackgroundShader);
+    ShaderBatchAdd(&shader_batch, &BeltShader);
+    ShaderBatchCompile(&shader_batch);
 
     TextureData SunData = {loadTexture("resources/2k_sun.jpg"), 0};
     unsigned int BackgroundTexture = loadTexture("resources/8k_stars_milky_way.jpg");
 
-    mat4 model = GLM_MAT4_IDENTITY_INIT;
     mat4 view;
+    mat4 background_view;
     mat4 projection = GLM_MAT4_IDENTITY_INIT;
-    glm_perspective(glm_rad(45.0), (float)WINDOWWIDTH / (float)WINDOWHEIGHT, 0.1f,
-                  1000.0f, projection);
+    DepthBufferProjection(&depth_buffer, glm_rad(45.0), (float)WINDOWWIDTH / (float)WINDOWHEIGHT, projection);
 
 
     glfwSetCursorPosCallback(window, mouse_callback);
@@ -136,130 +268,234 @@ int main() {
     vec3 lightColor = {1, 1, 1};
 
 
-    int segment = 32;
-    int sun_index_count = 0;
-    unsigned int SunVAO = create_sphere_vao_ebo(1, segment, segment, &sun_index_count);
-    int circle_index = 0;
-    int sphere_index_count = 0;
-    unsigned int SphereVAO = create_sphere_vao_ebo(1, segment, segment, &sphere_index_count);
-    int background_index_count = 0;
-    unsigned int BackgroundVAO = create_sphere_vao_ebo(1, 8, 8, &background_index_count);
-    planets_setup();
+    MeshPoolInit(&mesh_pool, MESH_FORMAT_COMPACT);
+    MeshRegistryInit(&mesh_registry, &mesh_pool);
+    for (int i = 0; i < SPHERE_LOD_COUNT; i++) {
+        int slices, stacks, uv_slices, uv_stacks;
+        sphere_detail_for_error(sphere_generator, 1, sphere_lod_errors[i], &slices, &stacks);
+        sphere_detail_for_error(SPHERE_UV, 1, sphere_lod_errors[i], &uv_slices, &uv_stacks);
+        printf("sphere LOD %d: error %.4f, %d triangles (UV sphere: %d)\n", i, sphere_lod_errors[i],
+               sphere_triangle_count(sphere_generator, slices, stacks),
+               sphere_triangle_count(SPHERE_UV, uv_slices, uv_stacks));
+        MeshRegistryAcquireSphere(&mesh_registry, sphere_generator, 1, slices, stacks, &sphere_lods[i]);
+    }
+    // the sky only needs the coarsest sphere, which the registry already holds
+    Mesh background_mesh;
+    int background_slices, background_stacks;
+    sphere_detail_for_error(sphere_generator, 1, sphere_lod_errors[0], &background_slices, &background_stacks);
+    MeshRegistryAcquireSphere(&mesh_registry, sphere_generator, 1, background_slices, background_stacks,
+                              &background_mesh);
+    MeshPoolUpload(&mesh_pool);
+    MeshRegistryPrint(&mesh_registry);
+    for (int t = 0; t < PLANET_SHADER_TIERS; t++)
+        MultiDrawInit(&planet_batches[t], &mesh_pool);
+    if (planets_setup() || !planet_count) {
+        printf("unable to load %s\n", BODY_CATALOGUE);
+        glfwTerminate();
+        return 1;
+    }
+    planets_ephemeris_setup();
+    // start fifty radii back from Earth, looking at it
+    update_body_positions();
+    struct PlanetData *home = &planets[0];
+    for (int j = 0; j < planet_count; j++) {
+        if (planets[j].body == CatalogueFind(&catalogue, "Earth"))
+            home = &planets[j];
+    }
+    for (int i = 0; i < 3; i++)
+        camera.Position[i] = home->position[i] - camera.Front[i] * 50 * home->size;
+    OrbitLinesInit(&orbit_lines, 128);
+    OrbitLinesBuild(&orbit_lines, &planet_orbits);
+    if (BeltInit(&belt, belt_populations, sizeof(belt_populations) / sizeof(belt_populations[0]), &catalogue,
+                 BELT_CATALOGUE_BRIGHTNESS, 1 / KM_PER_UNIT, SUN_GM, BELT_SEED, simulation_time)) {
+        // the rest of the system is still worth drawing
+        printf("unable to build the belts\n");
+        BeltDestroy(&belt);
+    }
     state = 1;
-    float previous_orbital_position[9][3];
-		
-		
-    ShaderUse(PlanetShader);
-    glUniform1i(glGetUniformLocation(PlanetShader.ID, "material.diffuse"), 0);
-    glUniform1i(glGetUniformLocation(PlanetShader.ID, "material.specular"), 1);
-    ShaderUse(SunShader);
-    glUniform1i(glGetUniformLocation(SunShader.ID, "diffuse"), 0);
-    ShaderUse(BackgroundShader);
-    glUniform1i(glGetUniformLocation(BackgroundShader.ID, "equirectangularMap"), 0);
-
+    TimeWarpInit(&time_warp, TIME_WARP_START);
+    if (RecordingInit(&recording, &moons, RECORDING_CAPACITY, RECORDING_INTERVAL))
+        printf("unable to allocate the recording, seeking is off\n");
+    RecordingUpdate(&recording, &moons, simulation_time, state);
+
+    if (ShaderBatchPending(&shader_batch))
+        printf("shaders still compiling after asset loading\n");
+    ShaderBatchFinish(&shader_batch);
+    ShaderCachePrintStats();
+    bind_sampler_units(&planet_variants, &SunShader, &BackgroundShader);
+    RenderQueueInit(&render_queue, FAR_PLANE);
+    ArenaPrintStats(&scratch_arena);
+    MemTrackPrintReport();
+
+    FrameStatsInit(&frame_stats, 3.0f, 30.0f);
+    lastFrame = glfwGetTime();
 
     while (!glfwWindowShouldClose(window)) {
-        float currentFrame = glfwGetTime();
+        ArenaReset(&frame_arena);
+        double currentFrame = glfwGetTime();
         deltaTime = currentFrame - lastFrame;
-        if (state & (1 << 0)) {
-            animation_time += deltaTime;
-        }
+        FrameStatsRecord(&frame_stats, deltaTime, currentFrame);
+        double step = state & (1 << 0) ? TimeWarpStep(&time_warp, deltaTime) : 0;
         if (state & (1 << 1)) {
             rotation_time += deltaTime;
         }
         lastFrame = currentFrame;
+
+        SimulationAdvance(&moons, simulation_time, step, sample_planet_positions, NULL);
+        simulation_time += step;
+        RecordingUpdate(&recording, &moons, simulation_time, state);
+        update_body_positions();
+        camera.MovementSpeed = camera_travel_speed();
         processInput(window);
 
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // sampler units are program state, a rebuilt program starts without them
+        if (ShaderWatchPoll(&shader_watch))
+            bind_sampler_units(&planet_variants, &SunShader, &BackgroundShader);
+
         glClearColor(1, 0,0,1);
+        DepthBufferBegin(&depth_buffer);
 
-        glDisable(GL_DEPTH_TEST);
-        glDepthMask(GL_FALSE);
-        ShaderUse(BackgroundShader);
-        GetViewMatrix(&camera, view);
-        view[3][0] = view[3][1] = view[3][2] = 0.0f;
-        glUniformMatrix4fv(glGetUniformLocation(BackgroundShader.ID, "view"), 1, GL_FALSE, &view[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(BackgroundShader.ID, "projection"), 1, GL_FALSE, &projection[0][0]);
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, BackgroundTexture);
-        glBindVertexArray(BackgroundVAO);
-        glDrawElements(GL_TRIANGLES, background_index_count, GL_UNSIGNED_INT, (void *)0);
-
-        glDepthMask(GL_TRUE); // Re-enable depth writing
-        glEnable(GL_DEPTH_TEST);
-                                                    
-        ShaderUse(PlanetShader);
         GetViewMatrix(&camera, view);
-        glUniform3f(glGetUniformLocation(PlanetShader.ID, "viewPos"), camera.Position[0], camera.Position[1], camera.Position[2]);
-        glUniform3f(glGetUniformLocation(PlanetShader.ID, "light.position"), lightPosition[0], lightPosition[1], lightPosition[2]);
-
-        glUniform3f(glGetUniformLocation(PlanetShader.ID, "light.ambient"), 0.2, 0.2, 0.2);
-        glUniform3f(glGetUniformLocation(PlanetShader.ID, "light.diffuse"), 0.5, 0.5, 0.5);
-        glUniform3f(glGetUniformLocation(PlanetShader.ID, "light.specular"), 1.0, 1.0, 1.0);
-        glUniform3f(glGetUniformLocation(PlanetShader.ID, "material.specular"), 0.5, 0.5, 0.5);
-        glUniform1f(glGetUniformLocation(PlanetShader.ID, "material.shininess"), 64);
-        glUniformMatrix4fv(glGetUniformLocation(PlanetShader.ID, "view"), 1, GL_FALSE,
-                                             &view[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(PlanetShader.ID, "projection"), 1,
-                                             GL_FALSE, &projection[0][0]);
-
-
-        for (int j = 0; j < 8; j++) {	
-            ShaderUse(PlanetShader);
-            // Render Planets
-            glm_mat4_identity(model);
-            previous_orbital_position[j][0] = planets[j].orbit_position[0] * sin(animation_time * planets[j].orbital_speed);
-            previous_orbital_position[j][1] = 0;
-            previous_orbital_position[j][2] = planets[j].orbit_position[0] * cos(animation_time * planets[j].orbital_speed);
-            glm_translate(model, (vec3) {
-                    previous_orbital_position[j][0], 
-                    1, 
-                    previous_orbital_position[j][2]
-                        });
-            glm_scale(model, (vec3) {planets[j].size, planets[j].size, planets[j].size} );
-            glm_rotate(model, planets[j].rotation_speed * rotation_time, (vec3) {0, 1, 0}); 
-            glUniformMatrix4fv(glGetUniformLocation(PlanetShader.ID, "model"), 1, GL_FALSE, &model[0][0]);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, planets[j].diffuse);
-            glBindVertexArray(SphereVAO);
-            glDrawElements(GL_TRIANGLES, sphere_index_count, GL_UNSIGNED_INT, (void *)0);
-
+        vec3 sun_offset;
+        CameraRelative(&camera, sun_position, sun_offset);
+        glm_mat4_copy(view, background_view);
+        background_view[3][0] = background_view[3][1] = background_view[3][2] = 0.0f;
 
-            ShaderUse(OrbitShader);
-            unsigned int CircleVAO = create_circle(max(planets[j].orbit_position[0], planets[j].orbit_position[2]), 128, &circle_index);
-            glm_mat4_identity(model);
-            glUniformMatrix4fv(glGetUniformLocation(SunShader.ID, "view"), 1, GL_FALSE,
+        // per-frame uniforms, set once per program before the queue runs
+        ShaderUse(BackgroundShader);
+        glUniformMatrix4fv(ShaderUniformLocation(&BackgroundShader, "view"), 1, GL_FALSE, &background_view[0][0]);
+        glUniformMatrix4fv(ShaderUniformLocation(&BackgroundShader, "projection"), 1, GL_FALSE, &projection[0][0]);
+
+        for (int t = 0; t < PLANET_SHADER_TIERS; t++) {
+            Shader *planet = planet_shaders[t];
+            ShaderUse(*planet);
+            glUniform3f(ShaderUniformLocation(planet, "viewPos"), 0, 0, 0);
+            glUniform3f(ShaderUniformLocation(planet, "light.position"), sun_offset[0], sun_offset[1], sun_offset[2]);
+
+            glUniform3f(ShaderUniformLocation(planet, "light.ambient"), 0.2, 0.2, 0.2);
+            glUniform3f(ShaderUniformLocation(planet, "light.diffuse"), 0.5, 0.5, 0.5);
+            glUniform3f(ShaderUniformLocation(planet, "light.specular"), 1.0, 1.0, 1.0);
+            glUniform3f(ShaderUniformLocation(planet, "material.specular"), 0.5, 0.5, 0.5);
+            glUniform1f(ShaderUniformLocation(planet, "material.shininess"), 64);
+            glUniformMatrix4fv(ShaderUniformLocation(planet, "view"), 1, GL_FALSE,
                                                  &view[0][0]);
-            glUniformMatrix4fv(glGetUniformLocation(SunShader.ID, "projection"), 1,
+            glUniformMatrix4fv(ShaderUniformLocation(planet, "projection"), 1,
                                                  GL_FALSE, &projection[0][0]);
-            glUniformMatrix4fv(glGetUniformLocation(SunShader.ID, "model"), 1, GL_FALSE,
-                             &model[0][0]);
-            glBindVertexArray(CircleVAO);
-            glDrawElements(GL_LINE_LOOP, circle_index, GL_UNSIGNED_INT, (void *)0);
+            glUniform1f(ShaderUniformLocation(planet, "logDepthScale"), log_depth_scale);
+        }
+
+        ShaderUse(OrbitShader);
+        glUniformMatrix4fv(ShaderUniformLocation(&OrbitShader, "view"), 1, GL_FALSE,
+                           &view[0][0]);
+        glUniformMatrix4fv(ShaderUniformLocation(&OrbitShader, "projection"), 1,
+                           GL_FALSE, &projection[0][0]);
+        glUniform1f(ShaderUniformLocation(&OrbitShader, "logDepthScale"), log_depth_scale);
+        vec3 camera_high, camera_low;
+        OrbitLinesSplit(camera.Position, camera_high, camera_low);
+        glUniform3fv(ShaderUniformLocation(&OrbitShader, "cameraHigh"), 1, camera_high);
+        glUniform3fv(ShaderUniformLocation(&OrbitShader, "cameraLow"), 1, camera_low);
+
+        if (belt.count) {
+            ShaderUse(BeltShader);
+            glUniformMatrix4fv(ShaderUniformLocation(&BeltShader, "view"), 1, GL_FALSE, &view[0][0]);
+            glUniformMatrix4fv(ShaderUniformLocation(&BeltShader, "projection"), 1, GL_FALSE, &projection[0][0]);
+            glUniform1f(ShaderUniformLocation(&BeltShader, "logDepthScale"), log_depth_scale);
+            glUniform3f(ShaderUniformLocation(&BeltShader, "origin"), sun_offset[0], sun_offset[1], sun_offset[2]);
+            glUniform1f(ShaderUniformLocation(&BeltShader, "time"), BeltTime(&belt, simulation_time));
         }
 
-        // render Sun
         ShaderUse(SunShader);
-        glm_mat4_identity(model);
-        glm_translate(model, lightPosition);
-        glm_scale(model, (vec3) {10, 10, 10});
-        glUniformMatrix4fv(glGetUniformLocation(SunShader.ID, "view"), 1, GL_FALSE,
+        glUniformMatrix4fv(ShaderUniformLocation(&SunShader, "view"), 1, GL_FALSE,
                            &view[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(SunShader.ID, "projection"), 1,
+        glUniformMatrix4fv(ShaderUniformLocation(&SunShader, "projection"), 1,
                            GL_FALSE, &projection[0][0]);
-        glUniform3f(glGetUniformLocation(SunShader.ID, "Color"), lightColor[0], lightColor[1], lightColor[2]);
+        glUniform1f(ShaderUniformLocation(&SunShader, "logDepthScale"), log_depth_scale);
+        glUniform3f(ShaderUniformLocation(&SunShader, "Color"), lightColor[0], lightColor[1], lightColor[2]);
+
+        RenderQueueReset(&render_queue);
+        RenderCommand command = {
+            .program = BackgroundShader.ID, .texture = BackgroundTexture, .vao = mesh_pool.VAO,
+            .mode = GL_TRIANGLES, .count = background_mesh.index_count, .index_type = mesh_pool.index_type,
+            .first_index = background_mesh.first_index, .base_vertex = background_mesh.base_vertex,
+            .model_location = -1,
+        };
+        RenderQueuePush(&render_queue, RENDER_PASS_BACKGROUND, 0, &command);
+
+        // planets go out as one batch per program variant, each with the LOD its screen size needs
+        for (int t = 0; t < PLANET_SHADER_TIERS; t++)
+            MultiDrawReset(&planet_batches[t]);
+        for (int j = 0; j < planet_count; j++) {	
+            // Render Planets
+            vec3 offset;
+            CameraRelative(&camera, planets[j].position, offset);
+            mat4 model = GLM_MAT4_IDENTITY_INIT;
+            glm_translate(model, offset);
+            glm_scale(model, (vec3) {planets[j].size, planets[j].size, planets[j].size} );
+            glm_rotate(model, planets[j].rotation_speed * rotation_time, (vec3) {0, 1, 0}); 
+            float distance = glm_vec3_norm(offset);
+            int lod = select_sphere_lod(planets[j].size, distance);
+            MultiDrawAdd(&planet_batches[PLANET_SHADER_TIER(lod)], sphere_lods[lod], model, planets[j].diffuse);
+        }
+        for (int t = 0; t < PLANET_SHADER_TIERS; t++) {
+            if (!planet_batches[t].draw_count)
+                continue;
+            command = (RenderCommand) {
+                .program = planet_shaders[t]->ID, .texture_target = GL_TEXTURE_2D_ARRAY, .texture = PlanetTextures,
+                .vao = mesh_pool.VAO, .model_location = -1, .multi_draw = &planet_batches[t],
+            };
+            RenderQueuePush(&render_queue, RENDER_PASS_OPAQUE, 0, &command);
+        }
 
-        glUniformMatrix4fv(glGetUniformLocation(SunShader.ID, "model"), 1, GL_FALSE,
-                 &model[0][0]);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, SunData.diffuse_data);
-        glBindVertexArray(SunVAO);
-        glDrawElements(GL_TRIANGLES, sun_index_count, GL_UNSIGNED_INT, (void *)0);
+        // every orbit ring in one draw
+        command = (RenderCommand) {
+            .program = OrbitShader.ID, .vao = orbit_lines.VAO,
+            .mode = GL_LINE_LOOP, .count = orbit_lines.index_count,
+            .model_location = -1,
+        };
+        RenderQueuePush(&render_queue, RENDER_PASS_LINES, 0, &command);
+
+        // every belt particle in one draw, placed by the vertex shader
+        if (belt.count) {
+            command = (RenderCommand) {
+                .program = BeltShader.ID, .vao = belt.VAO, .mode = GL_POINTS, .count = belt.count,
+                .arrays = true, .model_location = -1,
+            };
+            RenderQueuePush(&render_queue, RENDER_PASS_LINES, 0, &command);
+        }
 
+        // render Sun
+        float sun_distance = glm_vec3_norm(sun_offset);
+        Mesh sun_mesh = sphere_lods[select_sphere_lod(SUN_RADIUS, sun_distance)];
+        command = (RenderCommand) {
+            .program = SunShader.ID, .texture = SunData.diffuse_data, .vao = mesh_pool.VAO,
+            .mode = GL_TRIANGLES, .count = sun_mesh.index_count, .index_type = mesh_pool.index_type,
+            .first_index = sun_mesh.first_index, .base_vertex = sun_mesh.base_vertex,
+            .model_location = ShaderUniformLocation(&SunShader, "model"),
+        };
+        glm_translate_make(command.model, sun_offset);
+        glm_scale(command.model, (vec3) {SUN_RADIUS, SUN_RADIUS, SUN_RADIUS});
+        RenderQueuePush(&render_queue, RENDER_PASS_OPAQUE, sun_distance, &command);
+
+        RenderQueueSort(&render_queue);
+        RenderQueueExecute(&render_queue);
+        DepthBufferEnd(&depth_buffer);
+
+        GLStateEndFrame();
         glfwPollEvents();
         glfwSwapBuffers(window);
     }
+    FrameStatsPrintSummary(&frame_stats);
+    ShaderWatchClose(&shader_watch);
+    EphemerisClose(&planet_ephemeris);
+    DepthBufferDestroy(&depth_buffer);
+    RecordingFree(&recording);
+    SimulationFree(&moons);
+    KeplerOrbitsFree(&planet_orbits);
+    BeltDestroy(&belt);
+    MemTrackFree(MEM_SIMULATION, planets);
+    CatalogueFree(&catalogue);
+    ArenaDestroy(&frame_arena);
+    ArenaDestroy(&scratch_arena);
     glfwTerminate();
     return 0;
 }
@@ -270,6 +506,30 @@ void keyboard_callback(GLFWwindow* window, int key, int scancode, int action, in
 				state = state ^ (1 << 0);
 				printf("%i\n", state);
 	}
+	if (key == GLFW_KEY_PERIOD && action == GLFW_PRESS) {
+				TimeWarpChange(&time_warp, 1);
+	}
+	if (key == GLFW_KEY_COMMA && action == GLFW_PRESS) {
+				TimeWarpChange(&time_warp, -1);
+	}
+	if ((key == GLFW_KEY_LEFT_BRACKET || key == GLFW_KEY_RIGHT_BRACKET) && action == GLFW_PRESS) {
+				double target = simulation_time + (key == GLFW_KEY_LEFT_BRACKET ? -SCRUB_STEP : SCRUB_STEP);
+				if (!RecordingSeek(&recording, &moons, target, sample_planet_positions, NULL, NULL))
+					simulation_time = target;
+				printf("simulation time: %.1f days\n", simulation_time / 86400);
+	}
+	if (key == GLFW_KEY_F5 && action == GLFW_PRESS) {
+				if (!SnapshotSave(SNAPSHOT_PATH, &moons, simulation_time, state))
+					printf("saved %s\n", SNAPSHOT_PATH);
+	}
+	if (key == GLFW_KEY_F9 && action == GLFW_PRESS) {
+				uint32_t bits;
+				if (!SnapshotLoad(SNAPSHOT_PATH, &moons, &simulation_time, &bits)) {
+					state = bits;
+					RecordingTruncate(&recording, simulation_time);
+					RecordingUpdate(&recording, &moons, simulation_time, state);
+				}
+	}
 	if (key == GLFW_KEY_R && action == GLFW_PRESS) {
 				state = state ^ (1 << 1);
 				printf("%i\n", state);
@@ -277,6 +537,14 @@ void keyboard_callback(GLFWwindow* window, int key, int scancode, int action, in
 	if (key == GLFW_KEY_L && action == GLFW_PRESS) {
 				printf("%f, %f, %f\n", camera.Position[0], camera.Position[1], camera.Position[2]);
 	}
+	if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+				GLStatePrintCounters(GLStateLastFrame());
+				ArenaPrintStats(&frame_arena);
+				ArenaPrintStats(&scratch_arena);
+	}
+	if (key == GLFW_KEY_M && action == GLFW_PRESS) {
+				MemTrackPrintReport();
+	}
 	if (key == GLFW_KEY_D && action == GLFW_PRESS) {
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 	}
@@ -327,6 +595,7 @@ void mouse_callback(GLFWwindow *window, double xposIn, double yposIn) {
 
 void framebuffer_callback(GLFWwindow *window, int width, int height) {
     glViewport(0, 0, width, height);
+    DepthBufferResize(&depth_buffer, width, height);
 }
 
 unsigned int loadTexture(char const * path)
@@ -334,6 +603,8 @@ unsigned int loadTexture(char const * path)
     unsigned int textureID;
     glGenTextures(1, &textureID);
     
+    // the decoded image and the decoder's buffers all go once it is uploaded
+    ArenaMarker mark = ArenaMark(&scratch_arena);
     int width, height, nrComponents;
     unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
     if (data)
@@ -346,11 +617,13 @@ unsigned int loadTexture(char const * path)
         else if (nrComponents == 4)
             format = GL_RGBA;
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        FrameStatsNoteActivity(FRAME_ACTIVITY_TEXTURE_UPLOAD);
+        GLStateBindTexture(GL_TEXTURE_2D, textureID);
         glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
+        MemTrackTexture(MEM_TEXTURES, textureID, MemTrackTextureSize(width, height, 1, nrComponents, 1));
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); // equirectangular maps wrap in longitude
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -361,305 +634,243 @@ unsigned int loadTexture(char const * path)
         printf("Texture failed to load at path: %s\n", path);
         stbi_image_free(data);
     }
+    ArenaRelease(&scratch_arena, mark);
 
     return textureID;
 }
 
-// Generates unique vertices and indices for a sphere suitable for EBO rendering.
-// Allocates memory for vertices_out and indices_out. Caller must free this memory.
-void generate_sphere_indexed(
-    float radius, int slices, int stacks,
-    Vertex **vertices_out, int *vertex_count_out,
-    GLuint **indices_out, int *index_count_out)
+// Loads same-sized images into the layers of one GL_TEXTURE_2D_ARRAY, so
+// bodies with different textures can still be drawn in a single call.
+unsigned int loadTextureArray(char const **paths, int count)
 {
-    // --- Input Validation ---
-    if (!vertices_out || !vertex_count_out || !indices_out || !index_count_out || slices < 3 || stacks < 2 || radius <= 0.0f) {
-        if (vertices_out) *vertices_out = NULL;
-        if (vertex_count_out) *vertex_count_out = 0;
-        if (indices_out) *indices_out = NULL;
-        if (index_count_out) *index_count_out = 0;
-        // Optionally print an error message here
-        return;
-    }
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    GLStateBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+
+    int layer_width = 0, layer_height = 0, layer_components = 0;
+    for (int i = 0; i < count; i++) {
+        ArenaMarker mark = ArenaMark(&scratch_arena);
+        int width, height, nrComponents;
+        unsigned char *data = stbi_load(paths[i], &width, &height, &nrComponents, 0);
+        if (!data) {
+            printf("Texture failed to load at path: %s\n", paths[i]);
+            ArenaRelease(&scratch_arena, mark);
+            continue;
+        }
 
-    // --- Calculate buffer sizes ---
-    // Vertices: (slices + 1) vertices per stack ring * (stacks + 1) rings (incl. poles)
-    int numVertices = (slices + 1) * (stacks + 1);
-    // Indices: 2 triangles per quad * 3 indices per triangle = 6 indices per quad
-    //          slices quads per stack * stacks stacks
-    int numIndices = slices * stacks * 6;
-
-    // --- Allocate memory ---
-    Vertex *vertices = (Vertex*)malloc(numVertices * sizeof(Vertex));
-    GLuint *indices = (GLuint*)malloc(numIndices * sizeof(GLuint));
-
-    if (!vertices || !indices) {
-        // Allocation failed
-        free(vertices); // free(NULL) is safe
-        free(indices);
-        *vertices_out = NULL;
-        *vertex_count_out = 0;
-        *indices_out = NULL;
-        *index_count_out = 0;
-        return;
-    }
+        GLenum format = 0;
+        if (nrComponents == 1)
+            format = GL_RED;
+        else if (nrComponents == 3)
+            format = GL_RGB;
+        else if (nrComponents == 4)
+            format = GL_RGBA;
 
-    // --- Generate Unique Vertices ---
-    int vertexIndex = 0;
-    for (int i = 0; i <= stacks; ++i) { // Iterate through stacks (latitude) including poles
-        float stackAngle = i * M_PI / stacks; // theta (from 0 to PI)
-        float y = radius * cosf(stackAngle);
-        float xyRadius = radius * sinf(stackAngle); // Radius of the stack ring in the xy-plane
-
-        for (int j = 0; j <= slices; ++j) { // Iterate through slices (longitude) including seam vertex
-            float sliceAngle = j * 2.0f * M_PI / slices; // phi (from 0 to 2*PI)
-
-            // Vertex position
-            float x = xyRadius * cosf(sliceAngle);
-            float z = xyRadius * sinf(sliceAngle);
-            vertices[vertexIndex].position[0] = x;
-            vertices[vertexIndex].position[1] = y;
-            vertices[vertexIndex].position[2] = z;
-
-            // Normal (for a sphere centered at origin, it's the normalized position)
-            float invLen = 1.0f / radius; // Assuming radius > 0
-            vertices[vertexIndex].normal[0] = x * invLen;
-            vertices[vertexIndex].normal[1] = y * invLen;
-            vertices[vertexIndex].normal[2] = z * invLen;
-
-            // Texture coordinates (Spherical mapping)
-            vertices[vertexIndex].texCoord[0] = (float)j / slices; // U: 0 to 1
-            vertices[vertexIndex].texCoord[1] = (float)i / stacks; // V: 0 to 1
-
-            vertexIndex++;
+        // the first image that loads decides the size and format of every layer
+        if (!layer_width) {
+            layer_width = width;
+            layer_height = height;
+            layer_components = nrComponents;
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, format, width, height, count, 0, format, GL_UNSIGNED_BYTE, NULL);
+            MemTrackTexture(MEM_TEXTURES, textureID, MemTrackTextureSize(width, height, count, nrComponents, 1));
         }
-    }
-
-    // --- Generate Indices ---
-    int indexIndex = 0;
-    for (int i = 0; i < stacks; ++i) { // Iterate through stack bands
-        // Calculate the starting vertex index for the current and next stack rings
-        GLuint k1 = i * (slices + 1); // Start index of current stack
-        GLuint k2 = k1 + (slices + 1); // Start index of next stack
-
-        for (int j = 0; j < slices; ++j, ++k1, ++k2) {
-            // For each slice, form a quad using vertices from the current (k1) and next (k2) stack rings
-            // Vertices forming the quad: k1, k2, k1+1, k2+1
-            // Need to handle the wrap-around for the last slice? No, because we generated j <= slices vertices.
-            // k1+1 will correctly point to the seam vertex when j = slices-1.
-
-            // Triangle 1: (k1, k2, k1+1)
-            indices[indexIndex++] = k1;
-            indices[indexIndex++] = k2;
-            indices[indexIndex++] = k1 + 1;
-
-            // Triangle 2: (k1+1, k2, k2+1)
-            indices[indexIndex++] = k1 + 1;
-            indices[indexIndex++] = k2;
-            indices[indexIndex++] = k2 + 1;
+        if (width != layer_width || height != layer_height || nrComponents != layer_components) {
+            printf("Texture %s is %dx%dx%d, array layers are %dx%dx%d, skipping\n", paths[i],
+                   width, height, nrComponents, layer_width, layer_height, layer_components);
+            stbi_image_free(data);
+            ArenaRelease(&scratch_arena, mark);
+            continue;
         }
-    }
-
-    // --- Set output parameters ---
-    *vertices_out = vertices;
-    *vertex_count_out = numVertices;
-    *indices_out = indices;
-    *index_count_out = numIndices;
-
-    // Caller is responsible for freeing vertices and indices!
-}
 
-GLuint create_sphere_vao_ebo(float radius, int slices, int stacks, int *index_count_out)
-{
-    if (!index_count_out) {
-        // Need a place to store the index count
-        return 0;
+        FrameStatsNoteActivity(FRAME_ACTIVITY_TEXTURE_UPLOAD);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, width, height, 1, format, GL_UNSIGNED_BYTE, data);
+        stbi_image_free(data);
+        ArenaRelease(&scratch_arena, mark);
     }
-    *index_count_out = 0; // Initialize output parameter
 
-    Vertex *vertices = NULL;
-    GLuint *indices = NULL;
-    int vertex_count = 0;
-    int local_index_count = 0;
-
-    // 1. Generate vertex and index data
-    generate_sphere_indexed(radius, slices, stacks, &vertices, &vertex_count, &indices, &local_index_count);
-
-    // Check if data generation was successful
-    if (!vertices || !indices || vertex_count == 0 || local_index_count == 0) {
-        free(vertices); // Free any potentially allocated memory
-        free(indices);
-        return 0; // Indicate failure
+    if (layer_width) {
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     }
-
-    GLuint VAO, VBO, EBO; // Add EBO handle
-
-    // 2. Generate VAO, VBO, and EBO
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO); // Generate the Element Buffer Object
-
-    // 3. Bind the VAO
-    // All subsequent VBO, EBO, and attribute pointer settings will be associated with this VAO
-    glBindVertexArray(VAO);
-
-    // 4. Bind and buffer VBO data
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertex_count * sizeof(Vertex), vertices, GL_STATIC_DRAW);
-
-    // 5. Bind and buffer EBO data
-    // IMPORTANT: Bind EBO *while* the VAO is still bound.
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, local_index_count * sizeof(GLuint), indices, GL_STATIC_DRAW);
-
-    // 6. Set up vertex attribute pointers (this part is the same)
-    // Position attribute (location 0)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
-    glEnableVertexAttribArray(0);
-
-    // Normal attribute (location 1)
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-    glEnableVertexAttribArray(1);
-
-    // Texture coordinate attribute (location 2)
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
-    glEnableVertexAttribArray(2);
-
-    // 7. Unbind the VAO (!!! IMPORTANT !!!)
-    // Unbinding the VAO prevents accidental modification.
-    // It's crucial to unbind the VAO *before* unbinding the EBO if you were to unbind it explicitly,
-    // because the EBO binding is stored as part of the VAO's state.
-    glBindVertexArray(0);
-
-    // Optional: Unbind VBO and EBO after unbinding VAO (good practice, though not strictly required here
-    // as the VAO state captured the necessary bindings).
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0); // Note: EBO binding is part of VAO state
-
-    // 8. Free CPU memory (data is now on the GPU)
-    free(vertices);
-    free(indices);
-
-    // 9. Return the index count and VAO handle
-    *index_count_out = local_index_count;
-    return VAO;
+    return textureID;
 }
 
+// Picks the sphere LOD from the body's projected radius in pixels.
+int select_sphere_lod(float size, float distance)
+{
+    if (distance <= size)
+        return SPHERE_LOD_COUNT - 1;
 
+    float pixels_per_unit = (WINDOWHEIGHT * 0.5f) / tanf(glm_rad(45.0f) * 0.5f);
+    float radius_pixels = size / distance * pixels_per_unit;
+    if (radius_pixels < 8)
+        return 0;
+    if (radius_pixels < 32)
+        return 1;
+    if (radius_pixels < 128)
+        return 2;
+    return 3;
+}
 
-void planets_setup()
+int planets_setup()
 {
-	float scale_factor = 10.0; // 1 AU = 100 units
-	float planet_distances[] = {
-	10 +	0.39 * scale_factor,  // Mercury
-	10 +	0.72 * scale_factor,  // Venus
-	10 +	1.00 * scale_factor,  // Earth
-	10 +	1.52 * scale_factor,  // Mars
-	10 +	5.20 * scale_factor,  // Jupiter
-	10 +	9.58 * scale_factor,  // Saturn
-	10 +	19.22 * scale_factor, // Uranus
-	10 +	30.05 * scale_factor, // Neptune
-	10 +	39.48 * scale_factor  // Pluto
-	};
-	float planet_size[] = {0.5, 1, 1, 0.6, 6, 5, 3, 3};
-	float planet_rotation_speed[] = {
-		10.5,
-		6.5, 
-		1674, 
-		868, 
-		453, 
-		34800, 
-		9000, 
-		9700, 
-		48
-	};
-	float planet_orbital_speed[] = {
-		47.4,
-		35.0,
-		29.8,
-		24.1,
-		13.1,
-		9.7,
-		6.8,
-		5.4,
-		4.7
-	};
-	planets[0].diffuse = loadTexture("resources/2k_mercury.jpg"); 
-	planets[1].diffuse = loadTexture("resources/2k_venus_surface.jpg"); 
-	planets[2].diffuse = loadTexture("resources/2k_earth_daymap.jpg"); 
-	planets[3].diffuse = loadTexture("resources/2k_mars.jpg"); 
-	planets[4].diffuse = loadTexture("resources/2k_jupiter.jpg"); 
-	planets[5].diffuse = loadTexture("resources/2k_saturn.jpg"); 
-	planets[6].diffuse = loadTexture("resources/2k_uranus.jpg"); 
-	planets[7].diffuse = loadTexture("resources/2k_neptune.jpg"); 
-	for (int j = 0; j < 8; j++) {
-			planets[j].orbit_position[0] = planet_distances[j];
-			planets[j].orbit_position[1] = 0;
-			planets[j].orbit_position[2] = planet_distances[j];
-	}
-
-	for (int i = 0; i < 8; i++) {
-		planets[i].size = planet_size[i];
+	uint64_t key = CatalogueKey(BODY_CATALOGUE);
+	if (CatalogueOpen(&catalogue, BODY_CATALOGUE_BINARY, key)) {
+		if (CatalogueLoad(&catalogue, BODY_CATALOGUE))
+			return 1;
+		CatalogueSave(&catalogue, BODY_CATALOGUE_BINARY, key);
 	}
-	for (int i = 0; i < 8; i++) {
-		planets[i].rotation_speed = planet_rotation_speed[i]/30;
+	// diffuse holds the body's layer in PlanetTextures
+	ArenaMarker mark = ArenaMark(&scratch_arena);
+	char const **textures = ArenaAlloc(&scratch_arena, catalogue.texture_count * sizeof(char *));
+	int *orbit_of = ArenaAlloc(&scratch_arena, catalogue.count * sizeof(int));
+	for (int t = 0; t < catalogue.texture_count; t++)
+		textures[t] = CatalogueTexture(&catalogue, t);
+	PlanetTextures = loadTextureArray(textures, catalogue.texture_count);
+
+	// bodies with a surface about the Sun follow the ephemeris, ones without
+	// are belt particles read from the catalogue in place, and moons are
+	// integrated about their parent
+	int analytic = 0, drawn = 0, small = 0;
+	for (int k = 0; k < catalogue.count; k++) {
+		analytic += catalogue.parent[k] < 0 && catalogue.texture[k] >= 0;
+		small += catalogue.parent[k] < 0 && catalogue.texture[k] < 0;
+		drawn += catalogue.texture[k] >= 0;
 	}
-	for (int i = 0; i < 8; i++) {
-		planets[i].orbital_speed = planet_orbital_speed[i]/30;
+	KeplerOrbitsInit(&planet_orbits, analytic);
+	SimulationInit(&moons, catalogue.count - analytic - small, analytic, SUN_GM, SIMULATION_BUDGET);
+	planets = MemTrackAlloc(MEM_SIMULATION, (drawn + 1) * sizeof(*planets));
+	planet_count = 0;
+
+	const double gm_scale = 1 / (KM_PER_UNIT * KM_PER_UNIT * KM_PER_UNIT);
+	for (int k = 0; k < catalogue.count; k++) {
+		orbit_of[k] = -1;
+		int parent = catalogue.parent[k];
+		if (parent < 0 && catalogue.texture[k] < 0)
+			continue;
+		double a = catalogue.semi_major_axis[k] / KM_PER_UNIT;
+		double gm = catalogue.gm[k] * gm_scale;
+		double parent_gm = parent < 0 ? SUN_GM : catalogue.gm[parent] * gm_scale;
+		OrbitalElements orbit = {
+			.semi_major_axis = a, .eccentricity = catalogue.eccentricity[k],
+			.inclination = catalogue.inclination[k], .ascending_node = catalogue.ascending_node[k],
+			.argument_periapsis = catalogue.argument_periapsis[k], .mean_anomaly = catalogue.mean_anomaly[k],
+			.mean_motion = KeplerMeanMotion(a, parent_gm + gm),
+		};
+		int index;
+		if (parent < 0) {
+			index = orbit_of[k] = KeplerOrbitsAdd(&planet_orbits, &orbit);
+		} else if (orbit_of[parent] >= 0) {
+			index = SimulationAdd(&moons, orbit_of[parent], parent_gm, gm, &orbit, 0);
+		} else {
+			printf("%s: only moons of planets are simulated, skipped\n", CatalogueName(&catalogue, k));
+			continue;
+		}
+		if (index < 0 || catalogue.texture[k] < 0)
+			continue;
+		planets[planet_count++] = (struct PlanetData) {
+			.diffuse = catalogue.texture[k], .body = k, .orbit = index, .simulated = parent >= 0,
+			.rotation_speed = catalogue.rotation[k] / 30, .size = catalogue.radius[k] / KM_PER_UNIT,
+		};
 	}
+	ArenaRelease(&scratch_arena, mark);
+	return 0;
 }
 
-unsigned int create_circle(float r, int s, int *index)
+void update_body_positions()
 {
-		// Define circle parameters
-		float radius = r;
-		int segments = s; // More segments = smoother circle
-		float angle_step = 2 * M_PI / segments;
-
-    // Indices: 2 triangles per quad * 3 indices per triangle = 6 indices per quad
-    //          slices quads per stack * stacks stacks
-    int numIndices = 2 * segments;
-		// Allocate memory for vertices (2D positions)
-		float *circleVertices = malloc(2 * (segments + 1) * sizeof(float));
-    GLuint *indices = (GLuint*)malloc(numIndices * sizeof(GLuint));
-
-		for (int i = 0; i <= segments; i++) {
-				float angle = i * angle_step;
-				circleVertices[2*i] = radius * cos(angle); // X
-				circleVertices[2*i + 1] = radius * sin(angle); // Y
-		}
-
-
-		int indexIndex = 0;
-		for (int i = 0; i < segments; i++) {
-			unsigned int k1 = i;
-			unsigned int k2 = i + 1;
-
-			indices[indexIndex++] = k1;
-			indices[indexIndex++] = k2;
-		}
-		*index = indexIndex;
+    ArenaMarker mark = ArenaMark(&frame_arena);
+    double (*planet_positions)[3] = ArenaAlloc(&frame_arena, (planet_orbits.count + 1) * sizeof(*planet_positions));
+    double (*moon_positions)[3] = ArenaAlloc(&frame_arena, (moons.count + 1) * sizeof(*moon_positions));
+    sample_planet_positions(NULL, simulation_time, planet_positions);
+    SimulationPositions(&moons, (const double (*)[3])planet_positions, moon_positions);
+    for (int j = 0; j < planet_count; j++) {
+        const double *position = planets[j].simulated ? moon_positions[planets[j].orbit]
+                                                      : planet_positions[planets[j].orbit];
+        for (int i = 0; i < 3; i++)
+            planets[j].position[i] = position[i];
+    }
+    ArenaRelease(&frame_arena, mark);
+}
 
-		GLuint VAO, VBO, EBO;
+// past the ephemeris the elements are propagated directly
+void sample_planet_positions(void *user, double time, double (*positions)[3])
+{
+    if (EphemerisCovers(&planet_ephemeris, time))
+        EphemerisEvaluate(&planet_ephemeris, time, positions);
+    else
+        sample_planet_orbits(&planet_orbits, time, positions);
+}
 
-		glGenVertexArrays(1, &VAO);
-		glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO); // Generate the Element Buffer Object
+void sample_planet_orbits(void *orbits, double time, double (*positions)[3])
+{
+    KeplerOrbits *elements = orbits;
+    KeplerOrbitsPropagate(elements, time);
+    for (int k = 0; k < elements->count; k++) {
+        positions[k][0] = elements->x[k];
+        positions[k][1] = elements->y[k];
+        positions[k][2] = elements->z[k];
+    }
+}
 
-		glBindVertexArray(VAO);
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		glBufferData(GL_ARRAY_BUFFER, 2 * (segments + 1) * sizeof(float), circleVertices, GL_STATIC_DRAW);
+// a second's travel covers half the distance to the nearest surface, so
+// the camera can cross the system and still approach a planet gently
+float camera_travel_speed()
+{
+    const double *p = camera.Position;
+    double nearest = sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]) - SUN_RADIUS;
+    for (int j = 0; j < planet_count; j++) {
+        double d[3];
+        for (int i = 0; i < 3; i++)
+            d[i] = planets[j].position[i] - camera.Position[i];
+        double surface = sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) - planets[j].size;
+        if (surface < nearest)
+            nearest = surface;
+    }
+    return max(SPEED, 0.5 * nearest);
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexIndex * sizeof(GLuint), indices, GL_STATIC_DRAW);
-		// Position attribute (location = 0)
-		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
+void planets_ephemeris_setup()
+{
+    // the key covers everything the fit depends on, a stale file is refitted
+    int fit[] = {planet_orbits.count, PLANET_EPHEMERIS_COEFFICIENTS, KEPLER_ITERATIONS};
+    double range[] = {PLANET_EPHEMERIS_SPAN, PLANET_EPHEMERIS_SEGMENT};
+    uint64_t key = EphemerisHash(0xCBF29CE484222325ull, fit, sizeof(fit));
+    key = EphemerisHash(key, range, sizeof(range));
+    const double *columns[] = {
+        planet_orbits.semi_major_axis, planet_orbits.eccentricity, planet_orbits.inclination,
+        planet_orbits.ascending_node, planet_orbits.argument_periapsis, planet_orbits.mean_anomaly,
+        planet_orbits.mean_motion,
+    };
+    for (int c = 0; c < 7; c++)
+        key = EphemerisHash(key, columns[c], planet_orbits.count * sizeof(double));
+
+    if (!EphemerisOpen(&planet_ephemeris, PLANET_EPHEMERIS_PATH, key))
+        return;
+    double error = EphemerisGenerate(PLANET_EPHEMERIS_PATH, key, planet_orbits.count, 0, PLANET_EPHEMERIS_SPAN,
+                                     PLANET_EPHEMERIS_SEGMENT, PLANET_EPHEMERIS_COEFFICIENTS,
+                                     sample_planet_orbits, &planet_orbits);
+    if (error >= 0)
+        printf("ephemeris: fitted %s, largest error %g units\n", PLANET_EPHEMERIS_PATH, error);
+    if (error < 0 || EphemerisOpen(&planet_ephemeris, PLANET_EPHEMERIS_PATH, key))
+        printf("ephemeris: unavailable, propagating orbital elements every frame\n");
+}
 
-		glBindVertexArray(0);
-		free(circleVertices); // Free CPU data after uploading to GPU
-		free(indices);
-		return VAO;
+void bind_sampler_units(ShaderVariants *planet, Shader *sun, Shader *background)
+{
+    for (int i = 0; i < planet->count; i++) {
+        Shader *variant = &planet->variants[i];
+        ShaderUse(*variant);
+        glUniform1i(ShaderUniformLocation(variant, "material.diffuse"), 0);
+        glUniform1i(ShaderUniformLocation(variant, "material.specularMap"), 1);
+    }
+    ShaderUse(*sun);
+    glUniform1i(ShaderUniformLocation(sun, "diffuse"), 0);
+    ShaderUse(*background);
+    glUniform1i(ShaderUniformLocation(background, "equirectangularMap"), 0);
 }
 
 float max(float a, float b)
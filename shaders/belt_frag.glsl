@@ -0,0 +1,8 @@
+#version 330
+in float brightness;
+out vec4 FragColor;
+
+void main()
+{
+	FragColor = vec4(vec3(0.62, 0.56, 0.48) * brightness, 1);
+}
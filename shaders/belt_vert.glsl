@@ -0,0 +1,33 @@
+#version 330
+layout (location = 0) in vec4 aPeriapsis;  // axis towards periapsis times a, eccentricity
+layout (location = 1) in vec4 aAhead;      // axis 90 degrees ahead times b, mean motion
+layout (location = 2) in float aBrightness;
+layout (location = 3) in float aMeanAnomaly;   // at the epoch
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform vec3 origin;   // the Sun, relative to the camera
+uniform float time;    // seconds since the belt's epoch
+#ifdef HAS_LOG_DEPTH
+uniform float logDepthScale;
+#endif
+out float brightness;
+
+const float TAU = 6.28318530718;
+
+void main()
+{
+	// Danby's starting guess and a few Newton steps, plenty in float
+	float e = aPeriapsis.w;
+	float M = mod(aMeanAnomaly + aAhead.w * time + 3.14159265359, TAU) - 3.14159265359;
+	float E = M + 0.85 * e * sign(sin(M));
+	for (int i = 0; i < 5; i++)
+		E -= (E - e * sin(E) - M) / (1.0 - e * cos(E));
+	vec3 position = aPeriapsis.xyz * (cos(E) - e) + aAhead.xyz * sin(E);
+
+	gl_Position = projection * view * vec4(origin + position, 1.0);
+	brightness = aBrightness;
+#ifdef HAS_LOG_DEPTH
+	gl_Position.z = (log2(max(1e-6, 1.0 + gl_Position.w)) * logDepthScale - 1.0) * gl_Position.w;
+#endif
+}
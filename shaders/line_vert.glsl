@@ -1,10 +1,20 @@
 #version 330
-layout (location = 0) in vec2 aPos;
+layout (location = 0) in vec3 aPosHigh;
+layout (location = 1) in vec3 aPosLow;
 
 uniform mat4 projection;
-uniform mat4 model;
 uniform mat4 view;
+// the camera's world position, split like the vertices
+uniform vec3 cameraHigh;
+uniform vec3 cameraLow;
+#ifdef HAS_LOG_DEPTH
+uniform float logDepthScale;
+#endif
 void main()
 {
-	gl_Position = projection * view * model * vec4(aPos.x, 1, aPos.y, 1.0);
+	vec3 offset = (aPosHigh - cameraHigh) + (aPosLow - cameraLow);
+	gl_Position = projection * view * vec4(offset, 1.0);
+#ifdef HAS_LOG_DEPTH
+	gl_Position.z = (log2(max(1e-6, 1.0 + gl_Position.w)) * logDepthScale - 1.0) * gl_Position.w;
+#endif
 }
@@ -1,9 +1,20 @@
 #version 330 core
 out vec4 FragColor;
 
+// LOD_LEVEL is the finest sphere LOD the variant draws, bodies only ever
+// drawn with the two coarsest meshes are a few pixels across and a
+// highlight would not show
+#ifndef LOD_LEVEL
+#define LOD_LEVEL 3
+#endif
+#define USE_SPECULAR (LOD_LEVEL >= 2)
+
 struct Material {
-    sampler2D diffuse;
-    sampler2D specular;    
+    sampler2DArray diffuse;
+#ifdef HAS_SPECULAR_MAP
+    sampler2D specularMap;
+#endif
+    vec3 specular;
     float shininess;
 }; 
 
@@ -18,6 +29,7 @@ struct Light {
 in vec3 FragPos;  
 in vec3 Normal;  
 in vec2 TexCoords;
+flat in float Layer;
   
 uniform vec3 viewPos;
 uniform Material material;
@@ -26,20 +38,28 @@ uniform Light light;
 void main()
 {
     // ambient
-    vec3 ambient = light.ambient * texture(material.diffuse, TexCoords).rgb;
+    vec3 albedo = texture(material.diffuse, vec3(TexCoords, Layer)).rgb;
+    vec3 ambient = light.ambient * albedo;
   	
     // diffuse 
     vec3 norm = normalize(Normal);
     vec3 lightDir = normalize(light.position - FragPos);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoords).rgb;  
-    
+    vec3 diffuse = light.diffuse * diff * albedo;  
+    vec3 result = ambient + diffuse;
+
+#if USE_SPECULAR
     // specular
     vec3 viewDir = normalize(viewPos - FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);  
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    vec3 specular = light.specular * spec * (texture(material.specular, TexCoords).rgb);  
-        
-    vec3 result = ambient + diffuse + specular;
+#ifdef HAS_SPECULAR_MAP
+    vec3 specular = light.specular * spec * texture(material.specularMap, TexCoords).rgb;
+#else
+    vec3 specular = light.specular * spec * material.specular;
+#endif
+    result += specular;
+#endif
+
     FragColor = vec4(result, 1.0);
 } 
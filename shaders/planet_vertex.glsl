@@ -2,20 +2,42 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+// per-body instance data, see multi_draw.h
+layout (location = 3) in mat4 aModel;
+layout (location = 7) in float aLayer;
+
+// finest sphere LOD the variant draws, see planet_fragment.glsl
+#ifndef LOD_LEVEL
+#define LOD_LEVEL 3
+#endif
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
+flat out float Layer;
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+#ifdef HAS_LOG_DEPTH
+uniform float logDepthScale;    // 2 / log2(far + 1), see depth_buffer.h
+#endif
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;  
+    FragPos = vec3(aModel * vec4(aPos, 1.0));
+#if LOD_LEVEL < 2
+    // bodies are scaled uniformly, so the model matrix itself keeps the
+    // normal's direction and far variants skip the inverse
+    Normal = mat3(aModel) * aNormal;
+#else
+    Normal = mat3(transpose(inverse(aModel))) * aNormal;  
+#endif
     TexCoords = aTexCoords;
+    Layer = aLayer;
     
     gl_Position = projection * view * vec4(FragPos, 1.0);
+#ifdef HAS_LOG_DEPTH
+    // logarithmic depth when reversed-Z is unavailable
+    gl_Position.z = (log2(max(1e-6, 1.0 + gl_Position.w)) * logDepthScale - 1.0) * gl_Position.w;
+#endif
 }
@@ -6,11 +6,17 @@ layout (location = 2) in vec2 aTexCoords;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+#ifdef HAS_LOG_DEPTH
+uniform float logDepthScale;
+#endif
 
 out vec2 TexCoords;
 
 void main()
 {
     gl_Position = projection * view * model * vec4(aPos, 1.0);
+#ifdef HAS_LOG_DEPTH
+    gl_Position.z = (log2(max(1e-6, 1.0 + gl_Position.w)) * logDepthScale - 1.0) * gl_Position.w;
+#endif
 		TexCoords = aTexCoords;
 }
@@ -0,0 +1,24 @@
+#include <stdio.h>
+
+#include "../include/arena.h"
+#include "../include/catalogue.h"
+
+// Converts a text catalogue to the binary one main maps instead of
+// parsing. The binary remembers which text it came from, so main picks it
+// up only while that text is unchanged.
+int main(int argc, char **argv)
+{
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s bodies.txt bodies.bin\n", argv[0]);
+        return 2;
+    }
+    ArenaInit(&scratch_arena, "scratch", SCRATCH_ARENA_SIZE);
+    Catalogue catalogue;
+    int failed = CatalogueLoad(&catalogue, argv[1])
+              || CatalogueSave(&catalogue, argv[2], CatalogueKey(argv[1]));
+    if (!failed)
+        printf("wrote %s\n", argv[2]);
+    CatalogueFree(&catalogue);
+    ArenaDestroy(&scratch_arena);
+    return failed;
+}